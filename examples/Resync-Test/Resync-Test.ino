@@ -0,0 +1,175 @@
+//=======================================================================//
+/**
+ * @file Resync-Test.ino
+ * @author Vishnu Mohanan (@vishnumaiea)
+ * @brief "Pretty tiny Scheduler" is an Arduino library for writing non-blocking
+ * periodic tasks without using delay() or millis() routines.
+ *
+ * This sketch tests how SPANNING tasks catch up after the loop stalls. The
+ * reference task is called in every loop, so it steps through the intervals
+ * one by one. The stalled task has the same schedule, but is only called after
+ * random stalls of up to a few intervals. Every time the stalled task is called,
+ * its output and counters must be the same as the reference. This is repeated
+ * for different repetitions and both sleep modes, and the number of mismatches
+ * is printed at the end of each run.
+ *
+ * @version 2.2.0
+ * @link https://github.com/vishnumaiea/ptScheduler
+ * @date Last modified : +05:30 03:12:48 PM 21-10-2026, Wednesday
+ * @copyright License: MIT
+ *
+ */
+//=======================================================================//
+// Includes
+
+#include <ptScheduler.h>
+
+//=======================================================================//
+// Defines
+
+#define debugSerial   Serial
+#define RUN_TIME      500000  // Duration of a test run in microseconds
+#define MAX_STALL     5000  // Longest stall of the stalled task in microseconds
+#define MAX_REPEAT    5  // Repetitions are tested from 0 to this
+
+//=======================================================================//
+// Globals
+
+time_us_t intervalArray [] = {1000, 2000, 3000};
+
+// Create tasks
+ptScheduler referenceTask = ptScheduler (PT_MODE_SPANNING, intervalArray, 3); // called in every loop
+ptScheduler stalledTask = ptScheduler (PT_MODE_SPANNING, intervalArray, 3); // called after stalls
+
+uint8_t repetition = 0; // repetition of the ongoing run
+uint8_t sleepMode = PT_SLEEP_DISABLE; // sleep mode of the ongoing run
+uint32_t runStart = 0;  // start time of the ongoing run
+uint32_t lastCall = 0;  // last time the stalled task was called
+uint32_t stallTime = 0; // time to wait before calling the stalled task again
+uint32_t checkCount = 0;  // number of checks in the ongoing run
+uint32_t mismatchCount = 0; // number of mismatches in the ongoing run
+uint32_t totalMismatches = 0; // number of mismatches in all runs
+bool testDone = false;
+
+//=======================================================================//
+// Forward declarations
+
+void startRun();
+void endRun();
+bool isSame (bool referenceState, bool stalledState);
+
+//=======================================================================//
+
+void setup() {
+  debugSerial.begin (9600);
+  // while (!debugSerial);
+
+  randomSeed (micros());
+  startRun();
+}
+
+//=======================================================================//
+
+void loop() {
+  if (testDone) {
+    return;
+  }
+
+  bool stalledState = false;
+  bool isCalled = false;
+
+  // The stalled task is called first, and then the reference.
+  if ((micros() - lastCall) >= stallTime) {
+    stalledState = stalledTask.call();
+    isCalled = true;
+    lastCall = micros();
+    stallTime = random (MAX_STALL);
+  }
+
+  time_us_t entryTime = referenceTask.entryTime;
+  bool referenceState = referenceTask.call();
+
+  // If the reference reached the end of an interval after the stalled task was
+  // called, the two can not be compared in this loop.
+  if (isCalled && (referenceTask.entryTime == entryTime)) {
+    checkCount++;
+
+    if (!isSame (referenceState, stalledState)) {
+      mismatchCount++;
+    }
+  }
+
+  if ((micros() - runStart) >= RUN_TIME) {
+    endRun();
+  }
+}
+
+//=======================================================================//
+// starts a test run with the current repetition and sleep mode
+
+void startRun() {
+  referenceTask.setSequenceRepetition (repetition);
+  referenceTask.setSleepMode (sleepMode);
+  stalledTask.setSequenceRepetition (repetition);
+  stalledTask.setSleepMode (sleepMode);
+  referenceTask.reset();
+  stalledTask.reset();
+
+  // start both tasks and put them in the same phase
+  referenceTask.call();
+  stalledTask.call();
+  stalledTask.entryTime = referenceTask.entryTime;
+
+  checkCount = 0;
+  mismatchCount = 0;
+  runStart = micros();
+  lastCall = runStart;
+  stallTime = random (MAX_STALL);
+}
+
+//=======================================================================//
+// prints the result of a test run and starts the next one
+
+void endRun() {
+  debugSerial.print (F ("Repetition: "));
+  debugSerial.print (repetition);
+  debugSerial.print (F (", Sleep Mode: "));
+  debugSerial.print (sleepMode);
+  debugSerial.print (F (", Checks: "));
+  debugSerial.print (checkCount);
+  debugSerial.print (F (", Mismatches: "));
+  debugSerial.println (mismatchCount);
+
+  totalMismatches += mismatchCount;
+
+  if (repetition < MAX_REPEAT) {
+    repetition++;
+  }
+  else if (sleepMode == PT_SLEEP_DISABLE) {
+    repetition = 0;
+    sleepMode = PT_SLEEP_SUSPEND;
+  }
+  else {
+    debugSerial.println ((totalMismatches == 0) ? F ("Test passed") : F ("Test failed"));
+    testDone = true;
+    return;
+  }
+
+  startRun();
+}
+
+//=======================================================================//
+// compares the outputs and the states of the two tasks
+
+bool isSame (bool referenceState, bool stalledState) {
+  return (referenceState == stalledState) &&
+         (referenceTask.taskEnabled == stalledTask.taskEnabled) &&
+         (referenceTask.taskSuspended == stalledTask.taskSuspended) &&
+         (referenceTask.taskRunState == stalledTask.taskRunState) &&
+         (referenceTask.sequenceIndex == stalledTask.sequenceIndex) &&
+         (referenceTask.intervalCounter == stalledTask.intervalCounter) &&
+         (referenceTask.executionCounter == stalledTask.executionCounter) &&
+         (referenceTask.suspendedIntervalCounter == stalledTask.suspendedIntervalCounter);
+}
+
+//=======================================================================//
@@ -0,0 +1,90 @@
+
+//=======================================================================//
+/**
+ * @file Schedule-Image.ino
+ * @author Vishnu Mohanan (@vishnumaiea)
+ * @brief "Pretty tiny Scheduler" is an Arduino library for writing non-blocking
+ * periodic tasks without using delay() or millis() routines.
+ *
+ * This sketch compares the startup time of creating a large number of tasks
+ * in code against loading the same tasks from a binary schedule image.
+ * The image is created in RAM here, but on a host system you would normally
+ * write it to a file once and mmap() the file at startup.
+ *
+ * @version 2.2.0
+ * @link https://github.com/vishnumaiea/ptScheduler
+ * @date Last modified : +05:30 09:24:37 AM 20-10-2026, Tuesday
+ * @copyright License: MIT
+ *
+ */
+//=======================================================================//
+// Includes
+
+#include <ptScheduler.h>
+
+//=======================================================================//
+// Defines
+
+#define TASK_COUNT  32  // Increase this on boards with more RAM
+#define debugSerial Serial
+
+//=======================================================================//
+// Globals
+
+time_us_t intervalArray [] = {PT_TIME_100MS, PT_TIME_200MS, PT_TIME_500MS};
+
+ptScheduler codeTasks [TASK_COUNT];  // Tasks created in code
+ptScheduler imageTasks [TASK_COUNT];  // Tasks loaded from the image
+ptSchedule imageSchedules [TASK_COUNT];  // Schedules loaded from the image
+
+// The image buffer must be 8-byte aligned. Each interval takes two entries; the interval and its prefix sum.
+uint64_t imageBuffer [(sizeof (ptImageHeader) + (TASK_COUNT * (sizeof (ptImageRecord) + (6 * sizeof (time_us_t))))) / 8];
+
+//=======================================================================//
+
+void setup() {
+  debugSerial.begin (9600);
+
+  // Create the tasks one by one in code
+  uint32_t startTime = micros();
+
+  for (int i = 0; i < TASK_COUNT; i++) {
+    codeTasks [i] = ptScheduler (PT_MODE_SPANNING, intervalArray, 3);
+    codeTasks [i].setSequenceRepetition (4);
+    codeTasks [i].setSleepMode (PT_SLEEP_SUSPEND);
+    codeTasks [i].setSkipSequence (i % 8);
+  }
+
+  uint32_t codeTime = micros() - startTime;
+
+  // Save the schedules to an image; this is usually done once on the host
+  size_t imageSize = ptScheduleImage::write (codeTasks, TASK_COUNT, imageBuffer, sizeof (imageBuffer));
+
+  // Load the tasks from the image
+  ptScheduleImage image;
+  startTime = micros();
+
+  image.begin (imageBuffer, imageSize);
+  uint32_t loadedCount = image.applyAll (imageTasks, imageSchedules, TASK_COUNT);
+
+  uint32_t imageTime = micros() - startTime;
+
+  debugSerial.print (F ("Image size (bytes): "));
+  debugSerial.println ((uint32_t) imageSize);
+  debugSerial.print (F ("Tasks loaded: "));
+  debugSerial.println (loadedCount);
+  debugSerial.print (F ("Created in code (us): "));
+  debugSerial.println (codeTime);
+  debugSerial.print (F ("Loaded from image (us): "));
+  debugSerial.println (imageTime);
+}
+
+//=======================================================================//
+
+void loop() {
+  for (int i = 0; i < TASK_COUNT; i++) {
+    imageTasks [i].call();
+  }
+}
+
+//=======================================================================//
@@ -0,0 +1,246 @@
+//=======================================================================//
+/**
+ * @file Snapshot-Test.ino
+ * @author Vishnu Mohanan (@vishnumaiea)
+ * @brief "Pretty tiny Scheduler" is an Arduino library for writing non-blocking
+ * periodic tasks without using delay() or millis() routines.
+ *
+ * This sketch tests if a task restored from a snapshot continues exactly like
+ * a task that was never interrupted. The reference task is called in every
+ * loop. The sleeping task has the same schedule, but at random times its state
+ * is saved with snapshot(), and it is not called for a random time of up to a
+ * few intervals, like during deep sleep. It is then restored with the sleep
+ * time as the time offset. While both tasks are in the middle of an interval,
+ * their outputs and counters must be the same. Now and then both tasks are
+ * suspended or resumed together, in the middle of an interval. This is repeated
+ * for ONESHOT and SPANNING tasks with different repetitions, with normal and
+ * stretched intervals (see setIntervalScale()), and the number of mismatches is
+ * printed at the end of each run.
+ *
+ * @version 2.2.0
+ * @link https://github.com/vishnumaiea/ptScheduler
+ * @date Last modified : +05:30 07:47:52 PM 21-10-2026, Wednesday
+ * @copyright License: MIT
+ *
+ */
+//=======================================================================//
+// Includes
+
+#include <ptScheduler.h>
+
+//=======================================================================//
+// Defines
+
+#define debugSerial   Serial
+#define RUN_TIME      500000  // Duration of a test run in microseconds
+#define MAX_SLEEP     20000 // Longest sleep of the sleeping task in microseconds
+#define MARGIN        300 // The tasks are compared only this far from the ends of the intervals
+#define MAX_SCALE     4 // Interval scales are tested from 1 to this, in steps of 3
+
+//=======================================================================//
+// Globals
+
+time_us_t intervalArray [] = {2000, 3000, 5000};
+uint32_t repetitionList [] = {0, 1, 3, 30};  // repetitions tested
+
+// Create tasks
+ptScheduler referenceTask = ptScheduler (PT_MODE_ONESHOT, intervalArray, 3); // called in every loop
+ptScheduler sleepingTask = ptScheduler (PT_MODE_ONESHOT, intervalArray, 3); // saved and restored
+
+ptSnapshot sleepState;  // state of the sleeping task
+
+uint8_t taskMode = PT_MODE_ONESHOT; // mode of the ongoing run
+uint8_t repetitionIndex = 0; // index of the repetition of the ongoing run
+uint8_t intervalScale = 1;  // interval scale of the ongoing run
+uint32_t runStart = 0;  // start time of the ongoing run
+uint32_t sleepStart = 0;  // time the sleeping task went to sleep
+uint32_t sleepTime = 0; // how long the sleeping task sleeps
+uint32_t sleepCount = 0;  // number of sleeps in the ongoing run
+uint32_t suspendCount = 0;  // number of suspends and resumes in the ongoing run
+uint32_t checkCount = 0;  // number of checks in the ongoing run
+uint32_t mismatchCount = 0; // number of mismatches in the ongoing run
+uint32_t totalMismatches = 0; // number of mismatches in all runs
+bool isSleeping = false;
+bool testDone = false;
+
+//=======================================================================//
+// Forward declarations
+
+void startRun();
+void endRun();
+bool isQuiet();
+bool isSame (bool referenceState, bool sleepingState);
+
+//=======================================================================//
+
+void setup() {
+  debugSerial.begin (9600);
+  // while (!debugSerial);
+
+  randomSeed (micros());
+
+  // keep the ONESHOT intervals in phase, so that the reference task does not drift
+  // by the loop latency, which a restored task can not know
+  referenceTask.setSlackTime (1);
+  sleepingTask.setSlackTime (1);
+  startRun();
+}
+
+//=======================================================================//
+
+void loop() {
+  if (testDone) {
+    return;
+  }
+
+  bool sleepingState = false;
+  bool isCalled = false;
+
+  if (isSleeping) {
+    // wake up and restore the state, as if the clock had stopped during the sleep
+    if ((micros() - sleepStart) >= sleepTime) {
+      if (!sleepingTask.restore (sleepState, micros() - sleepStart)) {
+        mismatchCount++;
+      }
+      isSleeping = false;
+    }
+  }
+  else {
+    sleepingState = sleepingTask.call();
+    isCalled = true;
+
+    // go to sleep now and then
+    if (random (100) == 0) {
+      sleepingTask.snapshot (sleepState);
+      sleepStart = micros();
+      sleepTime = random (MAX_SLEEP);
+      sleepCount++;
+      isSleeping = true;
+    }
+  }
+
+  bool referenceState = referenceTask.call();
+
+  if (isCalled && isQuiet()) {
+    checkCount++;
+
+    if (!isSame (referenceState, sleepingState)) {
+      mismatchCount++;
+    }
+
+    // suspend or resume both tasks now and then, unless the sleeping task has just gone to sleep
+    if ((!isSleeping) && (random (200) == 0)) {
+      if (referenceTask.isSuspended()) {
+        referenceTask.resume();
+        sleepingTask.resume();
+      }
+      else {
+        referenceTask.suspend();
+        sleepingTask.suspend();
+      }
+      suspendCount++;
+    }
+  }
+
+  if ((micros() - runStart) >= RUN_TIME) {
+    endRun();
+  }
+}
+
+//=======================================================================//
+// starts a test run with the current mode and repetition
+
+void startRun() {
+  referenceTask.setTaskMode (taskMode);
+  referenceTask.setSequenceRepetition (repetitionList [repetitionIndex]);
+  sleepingTask.setTaskMode (taskMode);
+  sleepingTask.setSequenceRepetition (repetitionList [repetitionIndex]);
+  referenceTask.reset();
+  sleepingTask.reset();
+  referenceTask.setIntervalScale (intervalScale);
+  sleepingTask.setIntervalScale (intervalScale);
+
+  // start both tasks and put them in the same phase
+  referenceTask.call();
+  sleepingTask.call();
+  sleepingTask.entryTime = referenceTask.entryTime;
+
+  sleepCount = 0;
+  suspendCount = 0;
+  checkCount = 0;
+  mismatchCount = 0;
+  isSleeping = false;
+  runStart = micros();
+}
+
+//=======================================================================//
+// prints the result of a test run and starts the next one
+
+void endRun() {
+  debugSerial.print (F ("Mode: "));
+  debugSerial.print (taskMode);
+  debugSerial.print (F (", Repetition: "));
+  debugSerial.print (repetitionList [repetitionIndex]);
+  debugSerial.print (F (", Scale: "));
+  debugSerial.print (intervalScale);
+  debugSerial.print (F (", Sleeps: "));
+  debugSerial.print (sleepCount);
+  debugSerial.print (F (", Suspends: "));
+  debugSerial.print (suspendCount);
+  debugSerial.print (F (", Checks: "));
+  debugSerial.print (checkCount);
+  debugSerial.print (F (", Mismatches: "));
+  debugSerial.println (mismatchCount);
+
+  totalMismatches += mismatchCount;
+
+  if (repetitionIndex < ((sizeof (repetitionList) / sizeof (repetitionList [0])) - 1)) {
+    repetitionIndex++;
+  }
+  else if (intervalScale < MAX_SCALE) {
+    repetitionIndex = 0;
+    intervalScale += 3;
+  }
+  else if (taskMode == PT_MODE_ONESHOT) {
+    repetitionIndex = 0;
+    intervalScale = 1;
+    taskMode = PT_MODE_SPANNING;
+  }
+  else {
+    debugSerial.println ((totalMismatches == 0) ? F ("Test passed") : F ("Test failed"));
+    testDone = true;
+    return;
+  }
+
+  startRun();
+}
+
+//=======================================================================//
+// checks if the reference task is far enough from the ends of its intervals,
+// so that both tasks can be compared even if they were called a little apart
+
+bool isQuiet() {
+  if (!referenceTask.isEnabled()) {
+    return true;
+  }
+
+  return referenceTask.cycleStarted && (referenceTask.elapsedTime >= MARGIN) &&
+         (referenceTask.getTimeToNextRun() >= MARGIN);
+}
+
+//=======================================================================//
+// compares the outputs and the states of the two tasks
+
+bool isSame (bool referenceState, bool sleepingState) {
+  return (referenceState == sleepingState) &&
+         (referenceTask.taskEnabled == sleepingTask.taskEnabled) &&
+         (referenceTask.taskSuspended == sleepingTask.taskSuspended) &&
+         (referenceTask.taskRunState == sleepingTask.taskRunState) &&
+         (referenceTask.sequenceIndex == sleepingTask.sequenceIndex) &&
+         (referenceTask.intervalCounter == sleepingTask.intervalCounter) &&
+         (referenceTask.executionCounter == sleepingTask.executionCounter) &&
+         (referenceTask.sequenceRepetitionCounter == sleepingTask.sequenceRepetitionCounter) &&
+         (referenceTask.suspendedIntervalCounter == sleepingTask.suspendedIntervalCounter);
+}
+
+//=======================================================================//
@@ -11,7 +11,7 @@
  * 
  * @version 2.2.0
  * @link https://github.com/vishnumaiea/ptScheduler
- * @date Last modified : +05:30 09:53:39 AM 27-06-2023, Tuesday
+ * @date Last modified : +05:30 08:31:05 PM 21-10-2026, Wednesday
  * @copyright License: MIT
  * 
  */
@@ -21,129 +21,381 @@
 #include "ptScheduler.h"
 
 //==============================================================================//
-// Constructors
+// Schedules
+
+// Used by the tasks created with the default constructor. It has no intervals.
+static ptSchedule emptySchedule;
 
+//----------------------------------------------------------------------------//
 /**
- * @brief Creates the basic type of task. Accepts a single interval in microseconds.
- * The list will be only one interval long. Adding additional intervals later
- * will fail. The default mode is ONESHOT.
+ * @brief Creates a schedule with a single interval in microseconds and the
+ * working mode. Fallback mode is ONESHOT, in case of input error. inputError is
+ * set to true in case of input error.
  * 
+ * @param mode The working mode; can be PT_MODE_ONESHOT, PT_MODE_SPANNING, PT_MODE_RATELIMIT, PT_MODE_TRIGGERED or PT_MODE_CALENDAR.
  * @param interval_1 Interval value in microseconds.
- * @return ptScheduler:: 
+ * @return ptSchedule:: 
  */
-ptScheduler:: ptScheduler (time_us_t interval_1) {
-  sequenceList = new time_us_t (1);  //create a new interval list
+ptSchedule:: ptSchedule (uint8_t mode, time_us_t interval_1) {
+  sequenceList = new time_us_t [1];  // create a new list
   sequenceList [0] = interval_1;
   sequenceLength = 1;
-  // sequenceIndex = 0;
-  // taskEnabled = true;
+  sequenceListOwned = true;
+  updateSequence();
+  setTaskMode (mode);
+}
+
+//----------------------------------------------------------------------------//
+/**
+ * @brief Creates a schedule from a list of intervals. The array of intervals is
+ * not copied, so it has to be in the global scope. If the list is invalid, the
+ * schedule falls back to a single interval of PT_TIME_DEFAULT and inputError is
+ * set to true.
+ * 
+ * @param mode The working mode; can be PT_MODE_ONESHOT, PT_MODE_SPANNING, PT_MODE_RATELIMIT, PT_MODE_TRIGGERED or PT_MODE_CALENDAR.
+ * @param sequencePtr Pointer to the interval sequence (an array).
+ * @param sequenceLen Number of intervals in the sequence.
+ * @return ptSchedule:: 
+ */
+ptSchedule:: ptSchedule (uint8_t mode, time_us_t* sequencePtr, uint8_t sequenceLen) {
+  if ((sequencePtr != nullptr) && (sequenceLen != 0)) {
+    sequenceList = sequencePtr;
+    sequenceLength = sequenceLen;
+  }
+  else {  // if the input parameters are invalid
+    sequenceList = new time_us_t [1];
+    sequenceList [0] = PT_TIME_DEFAULT;
+    sequenceLength = 1;
+    sequenceListOwned = true;
+    inputError = true;
+  }
 
-  taskMode = PT_MODE_ONESHOT;
-  // sleepMode = PT_SLEEP_DISABLE;
+  updateSequence();
+  setTaskMode (mode);
 }
 
 //----------------------------------------------------------------------------//
 /**
- * @brief Creates the basic type of task. Accepts a single interval in microseconds
- * and the working mode. Fallback mode is ONESHOT, in case of input error.
- * Default sleep mode is DISABLE; the task will be disabled after executing
- * the first sequence. inputError is set to true in case of input error.
+ * @brief Creates a copy of a schedule. The interval sequence and the prefix
+ * sums are copied if the schedule allocated them. An interval sequence passed
+ * to the constructor (or loaded from an image) is not copied, and the copy uses
+ * the same array.
  * 
- * @param mode The working mode; can be PT_MODE_ONESHOT or PT_MODE_SPANNING.
- * @param interval_1 Interval value in microseconds.
- * @return ptScheduler:: 
+ * @param source The schedule to copy.
+ * @return ptSchedule:: 
  */
-ptScheduler:: ptScheduler (uint8_t mode, time_us_t interval_1) {
-  sequenceList = new time_us_t (1);  // create a new list
-  sequenceList [0] = interval_1;
-  sequenceLength = 1;
-  sequenceIndex = 0;
-  taskEnabled = true;
-  sleepMode = PT_SLEEP_DISABLE;
+ptSchedule:: ptSchedule (const ptSchedule& source) : ptScheduleData (source) {
+  if (sequenceListOwned) {
+    sequenceList = new time_us_t [sequenceLength];
 
-  switch (mode) {
-    case PT_MODE_ONESHOT:
-    case PT_MODE_SPANNING:
-      taskMode = mode;
-      break;
-    
-    default:
-      taskMode = PT_MODE_ONESHOT;
-      inputError = true;
-      break;
+    for (uint8_t i = 0; i < sequenceLength; i++) {
+      sequenceList [i] = source.sequenceList [i];
+    }
+  }
+
+  if (sequenceSumsLength > 0) {
+    sequenceSums = new time_us_t [sequenceSumsLength];
+
+    for (uint8_t i = 0; i < sequenceSumsLength; i++) {
+      sequenceSums [i] = source.sequenceSums [i];
+    }
+  }
+  else if (source.sequenceSums == source.sequenceList) {  // Single intervals are their own prefix sum
+    sequenceSums = sequenceList;
   }
 }
 
 //----------------------------------------------------------------------------//
 /**
- * @brief This accepts a list of intervals. You have to create an array of
- * intervals in the global scope and pass the pointer to this along with the
- * number of intervals in the array. The list of intervals is called an interval
- * sequence and the number of intervals as sequence length. The default mode is
- * ONESHOT. The default sleep mode is DISABLE; the task will be disabled after
- * executing the first sequence. inputError is set to true in case of input
- * error.
+ * @brief Moves a schedule. The new schedule takes over the interval sequence
+ * and the prefix sums without copying them. The moved schedule is left empty.
  * 
- * @param mode The working mode; can be PT_MODE_ONESHOT or PT_MODE_SPANNING.
- * @param sequencePtr Pointer to the interval sequence (an array).
- * @param sequenceLen Number of intervals in the sequence.
- * @return ptScheduler:: 
+ * @param source The schedule to move.
+ * @return ptSchedule:: 
  */
-ptScheduler:: ptScheduler (uint8_t mode, time_us_t* sequencePtr, uint8_t sequenceLen) {
-  if ((sequencePtr != nullptr) && (sequenceLen != 0)) {
-    sequenceList = sequencePtr;
-    sequenceLength = sequenceLen;
-    
-    sequenceIndex = 0;
-    taskEnabled = true;
-    sleepMode = PT_SLEEP_DISABLE;
-    
-    switch (mode) {
-      case PT_MODE_ONESHOT:
-      case PT_MODE_SPANNING:
-        taskMode = mode;
-        break;
-      
-      default:
-        taskMode = PT_MODE_ONESHOT;
-        inputError = true;  // when the user has made a mistake
-        break;
+ptSchedule:: ptSchedule (ptSchedule&& source) : ptScheduleData (source) {
+  source.abandonSequence();
+}
+
+//==============================================================================//
+/**
+ * @brief Frees the interval sequence and the prefix sums, if the schedule
+ * allocated them.
+ * 
+ * @return ptSchedule:: 
+ */
+ptSchedule:: ~ptSchedule() {
+  releaseSequence();
+}
+
+//==============================================================================//
+/**
+ * @brief Frees the interval sequence and the prefix sums, if the schedule
+ * allocated them. See ~ptSchedule().
+ * 
+ */
+void ptSchedule:: releaseSequence() {
+  if (sequenceListOwned) {
+    delete [] sequenceList;
+  }
+
+  if (sequenceSumsLength > 0) {
+    delete [] sequenceSums;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Forgets the interval sequence and the prefix sums without freeing them,
+ * after they were moved to another schedule. The schedule is left empty.
+ * 
+ */
+void ptSchedule:: abandonSequence() {
+  sequenceList = nullptr;
+  sequenceSums = nullptr;
+  sequencePeriod = 0;
+  sequenceLength = 0;
+  sequenceSumsLength = 0;
+  sequenceListOwned = false;
+}
+
+//==============================================================================//
+/**
+ * @brief Replaces a schedule with a copy of another schedule. See
+ * ptSchedule (const ptSchedule&).
+ * 
+ * @param source The schedule to copy.
+ * @return ptSchedule& This schedule.
+ */
+ptSchedule& ptSchedule:: operator= (const ptSchedule& source) {
+  if (this != &source) {
+    ptSchedule copy (source);
+    *this = static_cast<ptSchedule&&> (copy);
+  }
+  return *this;
+}
+
+//==============================================================================//
+/**
+ * @brief Replaces a schedule with another schedule, taking over what it owns.
+ * See ptSchedule (ptSchedule&&).
+ * 
+ * @param source The schedule to move.
+ * @return ptSchedule& This schedule.
+ */
+ptSchedule& ptSchedule:: operator= (ptSchedule&& source) {
+  if (this != &source) {
+    releaseSequence();
+    ptScheduleData::operator= (source);
+    source.abandonSequence();
+  }
+  return *this;
+}
+
+//==============================================================================//
+/**
+ * @brief Calculates the prefix sums and the total period of the interval
+ * sequence. The prefix sums allow finding the position in a schedule without
+ * summing up the intervals one by one. This is called by the constructors and
+ * setInterval(). If you change the intervals in the sequence list directly,
+ * call this function afterwards.
+ * 
+ * Single interval tasks use the sequence list itself as the prefix sum and
+ * don't need any extra memory.
+ */
+void ptSchedule:: updateSequence() {
+  if ((sequenceList == nullptr) || (sequenceLength == 0)) {
+    sequencePeriod = 0;
+    return;
+  }
+
+  if (sequenceLength == 1) {
+    sequenceSums = sequenceList;
+  }
+  else if (sequenceSumsLength < sequenceLength) {
+    if (sequenceSumsLength > 0) {
+      delete [] sequenceSums;
     }
+    sequenceSums = new time_us_t [sequenceLength];
+    sequenceSumsLength = sequenceLength;
   }
-  else {  // if the input parameters are invalid
-    ptScheduler (PT_TIME_DEFAULT);
-    inputError = true;
+
+  time_us_t sum = 0;
+
+  for (uint8_t i = 0; i < sequenceLength; i++) {
+    sum += sequenceList [i];
+
+    if (sequenceSums != sequenceList) {
+      sequenceSums [i] = sum;
+    }
   }
+  sequencePeriod = sum;
 }
 
 //==============================================================================//
 /**
- * @brief Does nothing for now.
+ * @brief Returns the time at which an interval starts, counted from the start
+ * of the first interval of the sequence. Intervals are counted continuously
+ * across sequences; interval 0 is the first interval of the first sequence.
  * 
- * @return ptScheduler:: 
+ * @param interval The interval number.
+ * @return time_us_t Start time of the interval in microseconds.
  */
-ptScheduler:: ~ptScheduler() {
-  
+time_us_t ptSchedule:: getIntervalStart (uint64_t interval) const {
+  if (sequenceLength == 0) {
+    return 0;
+  }
+
+  uint8_t index = interval % sequenceLength;
+  time_us_t start = (interval / sequenceLength) * sequencePeriod;
+
+  if (index > 0) {
+    start += sequenceSums [index - 1];
+  }
+  return start;
 }
 
 //==============================================================================//
 /**
- * @brief Calculates the time elapsed from the entry time, in microseconds.
- * The value is stored in the elapsedTime variable.
- * timeDelta is the difference between the current time and the entry time.
- * But in overflow events it may not indicate the actual difference in time.
- * Therefore, the actual real difference is calculated by subtracting the
- * previous timeDelta from the current timeDelta. This is the actual time
- * elapsed since the last time this function was called.
+ * @brief Returns the number of the interval that is ongoing at the given time,
+ * counted from the start of the first interval of the sequence. An interval
+ * that ends exactly at the given time is considered elapsed. The position inside
+ * the sequence is found with a binary search of the prefix sums.
  * 
+ * @param time Time in microseconds.
+ * @return uint64_t The interval number.
  */
-void ptScheduler:: getTimeElapsed() {
-  microsValue = GET_MICROS();
-  timeDelta = uint32_t (microsValue - entryTime);
-  uint32_t diff = uint32_t (timeDelta - prevTimeDelta);
+uint64_t ptSchedule:: getIntervalAt (time_us_t time) const {
+  if ((sequenceLength == 0) || (sequencePeriod == 0)) {
+    return 0;
+  }
 
-  elapsedTime += diff; 
-  prevTimeDelta = timeDelta;
+  time_us_t remainder = time % sequencePeriod;
+  uint8_t low = 0;
+  uint8_t high = sequenceLength;
+
+  // Find the number of intervals that have ended at the remainder time.
+  while (low < high) {
+    uint8_t middle = low + ((high - low) / 2);
+
+    if (sequenceSums [middle] <= remainder) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+
+  return ((time / sequencePeriod) * sequenceLength) + low;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the interval at which a finite repetition task completes all
+ * its repetitions and goes to sleep. The interval number is counted from the
+ * start of the schedule, the same way as in getIntervalAt().
+ * 
+ * @return uint64_t The interval number. 0 if the task repeats infinitely.
+ */
+uint64_t ptSchedule:: getEndInterval() const {
+  if (sequenceRepetition == 0) {
+    return 0;
+  }
+
+  if (taskMode == PT_MODE_SPANNING) {
+    // The state toggles after each interval, starting with true. The task sleeps
+    // at the end of the interval after the last rising state.
+    return (sequenceRepetitionExtended > 0) ? ((2 * uint64_t (sequenceRepetitionExtended)) - 1) : 1;
+  }
+
+  return uint64_t (sequenceRepetition) * sequenceLength;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the time at which the schedule starts, counted from the first
+ * call of the task. This is the skip duration, if one was set.
+ * 
+ * @return time_us_t Start time in microseconds.
+ */
+time_us_t ptSchedule:: getScheduleStart() const {
+  if (skipIntervalSet || skipSequenceSet || skipTimeSet) {
+    return skipTime;
+  }
+  return 0;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns how many times the task would have returned true by the given
+ * time, if it was running without interruption. The time is counted from the
+ * start of the first interval, excluding the skip duration. For ONESHOT tasks,
+ * this is the number of intervals started. For SPANNING tasks, this is the
+ * number of rising states. This function has no side effects.
+ * 
+ * @param time Position in the schedule in microseconds.
+ * @return uint64_t Number of executions.
+ */
+uint64_t ptSchedule:: getExecutionsAt (time_us_t time) const {
+  if (sequenceLength == 0) {
+    return 0;
+  }
+
+  uint64_t interval = getIntervalAt (time);
+  uint64_t endInterval = getEndInterval();
+
+  if (taskMode == PT_MODE_SPANNING) {
+    if ((endInterval > 0) && (interval >= endInterval)) {
+      return sequenceRepetitionExtended;
+    }
+    return (interval / 2) + 1;
+  }
+
+  if ((endInterval > 0) && (interval >= endInterval)) {
+    return endInterval;
+  }
+  return interval + 1;
+}
+
+//==============================================================================//
+/**
+ * @brief Computes the output of a task with this schedule at an arbitrary time,
+ * without changing anything. The time is counted from the first call of the task and
+ * includes the skip duration. The result follows the schedule definition (mode,
+ * intervals, skip and repetitions) of an uninterrupted task; runtime actions
+ * such as suspend() or disable() are not considered. The sleep mode does not
+ * matter here since both modes return false after the last repetition.
+ * 
+ * For SPANNING tasks, this is the level of the output at that time.
+ * For ONESHOT tasks, this is true only at the exact time an interval starts.
+ * Use getExecutionsAt() with two timestamps to find whether a oneshot task
+ * fires in a time window.
+ * 
+ * @param time Time in microseconds since the first call.
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptSchedule:: stateAt (time_us_t time) const {
+  time_us_t start = getScheduleStart();
+
+  // Rate limit and triggered tasks depend on when they are called, not only on time.
+  if ((sequenceLength == 0) || (time < start) || ((taskMode != PT_MODE_ONESHOT) && (taskMode != PT_MODE_SPANNING))) {
+    return false;
+  }
+
+  time -= start;
+  uint64_t interval = getIntervalAt (time);
+  uint64_t endInterval = getEndInterval();
+
+  if ((endInterval > 0) && (interval >= endInterval)) {
+    return false;
+  }
+
+  if (taskMode == PT_MODE_SPANNING) {
+    return (interval % 2) == 0;
+  }
+
+  return time == getIntervalStart (interval);
 }
 
 //==============================================================================//
@@ -152,14 +404,17 @@ void ptScheduler:: getTimeElapsed() {
  * valid. inputError is set to true in case of input error. Fallback mode is
  * ONESHOT.
  * 
- * @param mode The task working mode. Can be PT_MODE_ONESHOT or PT_MODE_SPANNING.
+ * @param mode The task working mode. Can be PT_MODE_ONESHOT, PT_MODE_SPANNING, PT_MODE_RATELIMIT, PT_MODE_TRIGGERED or PT_MODE_CALENDAR.
  * @return true Mode is valid.
  * @return false Mode is invalid.
  */
-bool ptScheduler:: setTaskMode (uint8_t mode) {
+bool ptSchedule:: setTaskMode (uint8_t mode) {
   switch (mode) {
     case PT_MODE_ONESHOT:
     case PT_MODE_SPANNING:
+    case PT_MODE_RATELIMIT:
+    case PT_MODE_TRIGGERED:
+    case PT_MODE_CALENDAR:
       taskMode = mode;
       return true;
       break;
@@ -193,7 +448,7 @@ bool ptScheduler:: setTaskMode (uint8_t mode) {
  * @return true Mode is valid.
  * @return false Mode is invalid.
  */
-bool ptScheduler:: setSleepMode (uint8_t mode) {
+bool ptSchedule:: setSleepMode (uint8_t mode) {
   switch (mode) { // check if the input mode is valid
     case PT_SLEEP_DISABLE:  // Disable mode
     case PT_SLEEP_SUSPEND:  // Suspend mode
@@ -211,650 +466,3902 @@ bool ptScheduler:: setSleepMode (uint8_t mode) {
 
 //==============================================================================//
 /**
- * @brief Determines whether a task should run or not. Enclose this function
- * call in any conditional clause to run the code block. Do not use any other
- * blocking delays inside or outside those blocks, which will defeat the 
- * purpose of this library.
- * 
- * For Oneshot tasks, the return state will be true only momentarily, after
- * an interval is elapsed. This allows you to run code blocks only once in
- * a given interval. For Spanning tasks, the return state will persist until
- * the ongoing interval is ended.
+ * @brief Let's you specify the number of times the interval sequence has to be
+ * executed. After the specified number of repetitions, the task will end and sleep
+ * either through DISABLE or SUSPEND mode. For RATELIMIT tasks, this is the number
+ * of permits to grant before sleeping. For TRIGGERED and CALENDAR tasks, this is the
+ * number of runs.
  * 
- * @return true Task to be executed.
- * @return false Task not to be executed.
+ * @param value The number of sequences to execute.
+ * @return true If the task in a valid mode and the repetition is set.
+ * @return false If operation failed.
  */
-bool ptScheduler:: call() {
+bool ptSchedule:: setSequenceRepetition (int32_t value) {
   switch (taskMode) {
     case PT_MODE_ONESHOT:
-      return oneshot();
-      
+    case PT_MODE_RATELIMIT: // The number of permits to grant
+    case PT_MODE_TRIGGERED: // The number of runs
+    case PT_MODE_CALENDAR:  // The number of runs
+      sequenceRepetition = value;
+      sequenceRepetitionExtended = value;
+      return true;
       break;
-
+    
     case PT_MODE_SPANNING:
-      return spanning();
-
+      // Determining how many sequenceRepetition have executed for a spanning task with odd no. of intervals is not
+      // straight forward as oneshot tasks. Odd number of intervals produce inverted output after every
+      // interval set. For example, if the intervals are 1000, 2000 and 3000, the first 1000 ms will be HIGH,
+      // next LOW for 2000 ms, then again high for 3000 ms. After that, the pattern is inverted. Since 3000 ms
+      // was HIGH, next 1000 ms will be LOW and so on. So counting just the HIGH states (execution counter) won't work.
+      // We need to calculate how many intervals we have to check to determine if the specified repetition has
+      // completed. But the user has to specify the number of sequenceRepetition only. Therefore we also calculate
+      // an additional parameter called sequenceRepetitionExtended which is the number of individual intervals to check.
+      sequenceRepetition = value;
+      
+      // If the sequenceRepetition is 1, then the sequenceRepetitionExtended is the same as the sequence length.
+      if (sequenceRepetition == 1) {
+        sequenceRepetitionExtended = sequenceLength;
+      }
+      else if ((sequenceRepetition % 2) == 1) { // If the sequenceRepetition is odd.
+        sequenceRepetitionExtended = uint32_t (((sequenceLength + 1) / 2) * sequenceRepetition);
+        sequenceRepetitionExtended--; // We need one less, otherwise there will be one extra active state.
+      }
+      else {
+        sequenceRepetitionExtended = uint32_t ((sequenceLength * sequenceRepetition) / 2);
+      }
+      return true;
       break;
-
+    
     default:
+      sequenceRepetition = 0;
+      sequenceRepetitionExtended = 0;
+      inputError = true;
+      return false;
       break;
   }
-  
   return false;
 }
 
 //==============================================================================//
 /**
- * @brief Implements the SPANNING task logic. The return state of a spanning
- * task will persist until the ongoing interval is ended. If you set the state
- * to true and wait for 2 seconds, then the sate will remain true until 2
- * seconds are passed. This is unlike ONESHOT logic which returns true only
- * momentarily.
+ * @brief Set the first interval value of an interval sequence.
  * 
- * @return true Task to be executed.
- * @return false Task not to be executed.
+ * @param value Time in microseconds.
+ * @return true If the value is set.
+ * @return false If the interval sequence is empty.
  */
-bool ptScheduler:: spanning() {
-  if (taskEnabled) {
-    // If an execution cycle has not started yet, defer the task until the time set by the
-    // user (called skip time). The user can specify the skip time in terms of time, sequence
-    // or interval.
-    if ((!taskStarted) && (skipIntervalSet || skipSequenceSet || skipTimeSet)) {
-      if (entryTime == 0) { // this is one way to find if an execution cycle has not started
-        elapsedTime = 0;
-        entryTime = GET_MICROS();
-        return false;
+bool ptSchedule:: setInterval (time_us_t value) {
+  if (sequenceLength > 0) {
+    sequenceList [0] = value;
+    updateSequence();
+    return true;
+  }
+  else {
+    inputError = true;
+    return false;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Let's you set the skip duration in terms of number of intervals to skip.
+ * The number of intervals to skip can also be greater than the number of intervals
+ * in the sequence. In that case, the skip duration will be calculated from the
+ * prefix sums of the sequence and saved to the skipTime variable. This takes the
+ * same time regardless of the number of intervals.
+ * 
+ * If you set both skip interval and skip iteration, the last call determines the
+ * skip duration.
+ * 
+ * @param value The number of intervals to skip.
+ * @return true If the operation is successful.
+ * @return false If the sequence is empty.
+ */
+bool ptSchedule:: setSkipInterval (uint32_t value) {
+  if (sequenceLength > 0) {
+    skipInterval = value;
+
+    if (value == 0) {
+      skipIntervalSet = false;
+      skipTime = 0;
+      return true;
+    }
+
+    skipIntervalSet = true;
+    skipTime = getIntervalStart (value); // The start of the first interval after the skipped ones
+    return true;
+  }
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Let's you specify the skip duration in terms of number of sequences
+ * to skip. The actual skip duration will be calculated as a multiple of the
+ * interval sequence. Also remember that an interval sequence is a set of intervals.
+ * 
+ * @param value The number of sequences to skip.
+ * @return true If the operation is successful.
+ * @return false If the sequence is empty.
+ */
+bool ptSchedule:: setSkipSequence (uint32_t value) {
+  if (sequenceLength > 0) {
+    skipSequence = value;
+
+    if (value == 0) {
+      skipSequenceSet = false;
+      skipTime = 0;
+      return true;
+    }
+    
+    skipSequenceSet = true;
+    skipTime = time_us_t (value) * sequencePeriod;
+    return true;
+  }
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the skip duration in terms of time in microseconds.
+ * 
+ * @param value Time in microseconds.
+ * @return true If the operation is successful.
+ * @return false If the sequence is empty.
+ */
+bool ptSchedule:: setSkipTime (time_us_t value) {
+  if (sequenceLength > 0) {
+    skipTime = value;
+    
+    if (value == 0) {
+      skipTimeSet = false;
+    }
+
+    skipTimeSet = true;
+    return true;
+  }
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets when a CALENDAR task runs. The interval of a calendar schedule is
+ * its period in microseconds, like in all other modes, and must be a whole number
+ * of seconds (see getCalendarPeriod()). The task runs whenever the wall clock
+ * reaches (offset + (k * period)) seconds since the Unix epoch. For example, a
+ * period of PT_TIME_1MIN and an offset of 0 runs on every minute, a period of
+ * (PT_EPOCH_15MIN * PT_TIME_1S) runs on every quarter hour, and a period of
+ * (PT_EPOCH_1DAY * PT_TIME_1S) and an offset of (2 * PT_EPOCH_1HOUR) runs every
+ * day at 02:00. Offsets larger than the period are reduced to the remainder.
+ * 
+ * The days of the week can be limited only if the period divides a day evenly.
+ * The days are counted from the time returned by the clock source, so if you
+ * want local days and times, make the clock source return the local time.
+ * 
+ * @param offset Offset of the fire times from the Unix epoch, in seconds.
+ * @param days Days of the week to run on. A combination of PT_DAY_* values.
+ * @return true If the values are set.
+ * @return false If the period is not a whole number of seconds, no days are given, or the period does not divide a day.
+ */
+bool ptSchedule:: setCalendar (time_s_t offset, uint8_t days) {
+  time_s_t period = getCalendarPeriod();
+
+  if ((period == 0) || ((days & PT_DAY_ALL) == 0)) {
+    inputError = true;
+    return false;
+  }
+
+  if (((days & PT_DAY_ALL) != PT_DAY_ALL) && ((PT_EPOCH_1DAY % period) != 0)) {
+    inputError = true;
+    return false;
+  }
+
+  calendarOffset = offset % period;
+  calendarDays = days & PT_DAY_ALL;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the period of a CALENDAR schedule in seconds. The interval is
+ * in microseconds like in all other modes, and is converted here.
+ * 
+ * @return time_s_t The period in seconds. 0 if the schedule has no interval, or
+ * the interval is not a whole number of seconds.
+ */
+time_s_t ptSchedule:: getCalendarPeriod() const {
+  if ((sequenceLength == 0) || ((sequenceList [0] % PT_TIME_1S) != 0)) {
+    return 0;
+  }
+  return sequenceList [0] / PT_TIME_1S;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the first fire time of a CALENDAR schedule at or after the
+ * given time. This is calculated directly from the period and offset, so it
+ * takes the same time however far the next fire time is. At most a week of
+ * days is checked for the days of the week.
+ * 
+ * @param time Wall clock time in seconds since the Unix epoch.
+ * @return time_s_t The fire time in seconds since the Unix epoch. 0 if the schedule has no period.
+ */
+time_s_t ptSchedule:: getNextFire (time_s_t time) const {
+  time_s_t period = getCalendarPeriod();
+
+  if (period == 0) {
+    return 0;
+  }
+
+  time_s_t next = calendarOffset;
+
+  if (time > calendarOffset) {
+    next += (((time - calendarOffset) + period - 1) / period) * period;
+  }
+
+  if ((calendarDays == PT_DAY_ALL) || ((PT_EPOCH_1DAY % period) != 0)) {
+    return next;
+  }
+
+  // Every day has the same fire times, since the period divides a day.
+  // So if the day is not allowed, the first fire time of the next allowed day is used.
+  time_s_t day = next / PT_EPOCH_1DAY;
+
+  for (uint8_t i = 0; i < 7; i++) {
+    uint8_t weekday = (day + i + 4) % 7;  // 1 January 1970 was a Thursday
+
+    if (calendarDays & (1 << weekday)) {
+      return (i == 0) ? next : (((day + i) * PT_EPOCH_1DAY) + calendarOffset);
+    }
+  }
+  return next;
+}
+
+//==============================================================================//
+/**
+ * @brief Makes a copy of a schedule that owns all of its memory. The interval
+ * sequence is copied too, even if the original does not own it, so that the
+ * copy can be changed without affecting the original.
+ * 
+ * @param source The schedule to copy.
+ * @return ptSchedule* The new schedule. Free it with delete.
+ */
+static ptSchedule* copySchedule (const ptSchedule& source) {
+  ptSchedule* copy = new ptSchedule (source);
+
+  if ((!copy->sequenceListOwned) && (source.sequenceLength > 0)) {
+    copy->sequenceList = new time_us_t [source.sequenceLength];
+    copy->sequenceListOwned = true;
+
+    for (uint8_t i = 0; i < source.sequenceLength; i++) {
+      copy->sequenceList [i] = source.sequenceList [i];
+    }
+
+    if (copy->sequenceSumsLength == 0) {  // The prefix sums were not owned either
+      copy->sequenceSums = nullptr;
+      copy->updateSequence();
+    }
+  }
+
+  return copy;
+}
+
+//==============================================================================//
+// Schedules of the tasks created with a single interval, like
+// ptScheduler (PT_TIME_1S). The interval is kept in the same allocation as the
+// schedule, and tasks with the same mode and interval share one schedule, which
+// is freed when the last of them lets go of it. Tasks copy it before changing it,
+// like any other shared schedule.
+
+struct ptSingleSchedule : public ptSchedule {
+  time_us_t interval = 0; // The only interval of the sequence
+  uint32_t useCount = 0;  // Number of tasks using the schedule
+  ptSingleSchedule* next = nullptr; // The next schedule in the list
+};
+
+static ptSingleSchedule* singleSchedules = nullptr; // List of the single interval schedules in use
+
+//==============================================================================//
+/**
+ * @brief Finds a single interval schedule with the given mode and interval, or
+ * creates one if there is none. Invalid modes get a schedule of their own, with
+ * inputError set.
+ * 
+ * @param mode The working mode.
+ * @param interval Interval value in microseconds.
+ * @return ptSchedule* The schedule. Let go of it with releaseSingleSchedule().
+ */
+static ptSchedule* getSingleSchedule (uint8_t mode, time_us_t interval) {
+  for (ptSingleSchedule* node = singleSchedules; node != nullptr; node = node->next) {
+    if ((node->taskMode == mode) && (node->interval == interval) && (!node->inputError)) {
+      node->useCount++;
+      return node;
+    }
+  }
+
+  ptSingleSchedule* node = new ptSingleSchedule;
+  node->interval = interval;
+  node->sequenceList = &node->interval; // Not owned; it is freed with the schedule
+  node->sequenceLength = 1;
+  node->updateSequence();
+  node->setTaskMode (mode);
+  node->useCount = 1;
+  node->next = singleSchedules;
+  singleSchedules = node;
+  return node;
+}
+
+//==============================================================================//
+/**
+ * @brief Lets go of a schedule found with getSingleSchedule(), and frees it if
+ * no other task uses it.
+ * 
+ * @param schedule The schedule.
+ */
+static void releaseSingleSchedule (const ptSchedule* schedule) {
+  for (ptSingleSchedule** link = &singleSchedules; *link != nullptr; link = &(*link)->next) {
+    if (*link == schedule) {
+      ptSingleSchedule* node = *link;
+
+      if (--node->useCount == 0) {
+        *link = node->next;
+        delete node;
       }
-      else {
-        elapsedTime = GET_MICROS() - entryTime;
+      return;
+    }
+  }
+}
+
+//==============================================================================//
+// Constructors
+
+/**
+ * @brief Creates an empty task without an interval sequence. The task is
+ * disabled and does not allocate any memory. This allows you to create large
+ * contiguous arrays of tasks that are configured later, for example with
+ * setSchedule() or from a schedule image using ptScheduleImage::applyAll().
+ * Until a schedule is assigned, call() always returns false, even if the task
+ * is enabled.
+ * 
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ptScheduler() {
+  schedule = &emptySchedule;
+  scheduleShared = true;
+  taskEnabled = false;
+  prepareModeState (schedule->taskMode);
+}
+
+//----------------------------------------------------------------------------//
+/**
+ * @brief Creates the basic type of task. Accepts a single interval in microseconds.
+ * The list will be only one interval long. Adding additional intervals later
+ * will fail. The default mode is ONESHOT. Tasks with the same interval share
+ * one schedule until one of them changes it.
+ * 
+ * @param interval_1 Interval value in microseconds.
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ptScheduler (time_us_t interval_1) {
+  schedule = getSingleSchedule (PT_MODE_ONESHOT, interval_1);  // shared with the tasks of the same interval
+  scheduleShared = true;
+  scheduleInterned = true;
+  prepareModeState (schedule->taskMode);
+  // sequenceIndex = 0;
+  // taskEnabled = true;
+}
+
+//----------------------------------------------------------------------------//
+/**
+ * @brief Creates the basic type of task. Accepts a single interval in microseconds
+ * and the working mode. Fallback mode is ONESHOT, in case of input error.
+ * Default sleep mode is DISABLE; the task will be disabled after executing
+ * the first sequence. inputError is set to true in case of input error. Tasks
+ * with the same mode and interval share one schedule until one of them changes
+ * it.
+ * 
+ * @param mode The working mode; can be PT_MODE_ONESHOT, PT_MODE_SPANNING, PT_MODE_RATELIMIT, PT_MODE_TRIGGERED or PT_MODE_CALENDAR.
+ * @param interval_1 Interval value in microseconds.
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ptScheduler (uint8_t mode, time_us_t interval_1) {
+  schedule = getSingleSchedule (mode, interval_1);  // shared with the tasks of the same mode and interval
+  scheduleShared = true;
+  scheduleInterned = true;
+  sequenceIndex = 0;
+  taskEnabled = true;
+  inputError = schedule->inputError;
+  prepareModeState (schedule->taskMode);
+}
+
+//----------------------------------------------------------------------------//
+/**
+ * @brief This accepts a list of intervals. You have to create an array of
+ * intervals in the global scope and pass the pointer to this along with the
+ * number of intervals in the array. The list of intervals is called an interval
+ * sequence and the number of intervals as sequence length. The default mode is
+ * ONESHOT. The default sleep mode is DISABLE; the task will be disabled after
+ * executing the first sequence. inputError is set to true in case of input
+ * error.
+ * 
+ * @param mode The working mode; can be PT_MODE_ONESHOT, PT_MODE_SPANNING, PT_MODE_RATELIMIT, PT_MODE_TRIGGERED or PT_MODE_CALENDAR.
+ * @param sequencePtr Pointer to the interval sequence (an array).
+ * @param sequenceLen Number of intervals in the sequence.
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ptScheduler (uint8_t mode, time_us_t* sequencePtr, uint8_t sequenceLen) {
+  schedule = new ptSchedule (mode, sequencePtr, sequenceLen);  // create a private schedule
+  sequenceIndex = 0;
+  taskEnabled = true;
+  inputError = schedule->inputError;  // when the user has made a mistake
+  prepareModeState (schedule->taskMode);
+}
+
+//----------------------------------------------------------------------------//
+/**
+ * @brief Creates a task that uses a shared schedule. The schedule is not copied,
+ * so it must remain valid as long as the task uses it. Any number of tasks can
+ * share the same schedule; each of them only keeps its own runtime state. If you
+ * change the schedule through the task later (with setInterval(), setTaskMode()
+ * etc.), the task gets its own copy of the schedule first, so that the other
+ * tasks are not affected.
+ * 
+ * @param sharedSchedule The schedule to use.
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ptScheduler (const ptSchedule& sharedSchedule) {
+  schedule = (ptSchedule*) &sharedSchedule;
+  scheduleShared = true;
+  sequenceIndex = 0;
+  taskEnabled = (schedule->sequenceLength > 0);
+  inputError = schedule->inputError;
+  prepareModeState (schedule->taskMode);
+}
+
+//----------------------------------------------------------------------------//
+/**
+ * @brief Creates a copy of a task, with the same schedule and runtime state.
+ * If the task owns its schedule, the copy gets its own copy of the schedule, so
+ * that changing one of them does not change the other. A shared schedule stays
+ * shared. The list of dependent tasks and the profile are copied as well.
+ * 
+ * @param task The task to copy.
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ptScheduler (const ptScheduler& task) : ptTaskState (task) {
+  if (!scheduleShared) {
+    schedule = copySchedule (*task.schedule);
+  }
+  else if (scheduleInterned) {
+    static_cast<ptSingleSchedule*> (schedule)->useCount++;
+  }
+
+  if (profile != nullptr) {
+    profile = new ptTaskProfile (*task.profile);
+    profile->cyclic = nullptr;  // The copy is not in the task array of the cyclic executive
+
+    if (profile->dependentList != nullptr) {
+      profile->dependentList = new ptScheduler* [profile->dependentCount];
+
+      for (uint8_t i = 0; i < profile->dependentCount; i++) {
+        profile->dependentList [i] = task.profile->dependentList [i];
+      }
+    }
+  }
+}
+
+//----------------------------------------------------------------------------//
+/**
+ * @brief Moves a task, like when a temporary task is stored. The new task takes
+ * over the schedule, the dependent list and the profile, without copying them.
+ * The moved task is left disabled and without a schedule. Neither of them stays
+ * attached to a ptCyclic.
+ * 
+ * @param task The task to move.
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ptScheduler (ptScheduler&& task) : ptTaskState (task) {
+  task.abandonState();
+
+  if (profile != nullptr) {
+    profile->cyclic = nullptr;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Frees the schedule if the task owns it, and the profile with the
+ * dependent list.
+ * 
+ * @return ptScheduler:: 
+ */
+ptScheduler:: ~ptScheduler() {
+  releaseState();
+}
+
+//==============================================================================//
+/**
+ * @brief Frees everything the task owns. See ~ptScheduler().
+ * 
+ */
+void ptScheduler:: releaseState() {
+  releaseSchedule();
+
+  if (profile != nullptr) {
+    delete [] profile->dependentList;
+    delete profile;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Frees the schedule if the task owns it, or lets go of it if it is a
+ * shared single interval schedule. Other shared schedules are left alone.
+ * 
+ */
+void ptScheduler:: releaseSchedule() {
+  if (!scheduleShared) {
+    delete schedule;
+  }
+  else if (scheduleInterned) {
+    releaseSingleSchedule (schedule);
+  }
+
+  scheduleInterned = false;
+}
+
+//==============================================================================//
+/**
+ * @brief Forgets everything the task owns without freeing it, after it was
+ * moved to another task. The task is left disabled and without a schedule.
+ * 
+ */
+void ptScheduler:: abandonState() {
+  taskEnabled = false;
+  updateCyclic(); // The moved task is no longer due in a cyclic executive
+  schedule = &emptySchedule;
+  scheduleShared = true;
+  scheduleInterned = false;
+  profile = nullptr;
+}
+
+//==============================================================================//
+/**
+ * @brief Replaces a task with a copy of another task. See
+ * ptScheduler (const ptScheduler&).
+ * 
+ * @param task The task to copy.
+ * @return ptScheduler& This task.
+ */
+ptScheduler& ptScheduler:: operator= (const ptScheduler& task) {
+  if (this != &task) {
+    ptScheduler copy (task);
+    *this = static_cast<ptScheduler&&> (copy);
+  }
+  return *this;
+}
+
+//==============================================================================//
+/**
+ * @brief Replaces a task with another task, taking over what it owns. See
+ * ptScheduler (ptScheduler&&).
+ * 
+ * @param task The task to move.
+ * @return ptScheduler& This task.
+ */
+ptScheduler& ptScheduler:: operator= (ptScheduler&& task) {
+  if (this != &task) {
+    releaseState();
+    ptTaskState::operator= (task);
+    task.abandonState();
+
+    if (profile != nullptr) {
+      profile->cyclic = nullptr;
+    }
+  }
+  return *this;
+}
+
+//==============================================================================//
+/**
+ * @brief Calculates the time elapsed from the entry time, in microseconds.
+ * The value is stored in the elapsedTime variable.
+ * timeDelta is the difference between the current time and the entry time.
+ * But in overflow events it may not indicate the actual difference in time.
+ * Therefore, the actual real difference is calculated by subtracting the
+ * previous timeDelta from the current timeDelta. This is the actual time
+ * elapsed since the last time this function was called.
+ * 
+ */
+void ptScheduler:: getTimeElapsed() {
+  microsValue = GET_MICROS();
+  timeDelta = uint32_t (microsValue - entryTime);
+  uint32_t diff = uint32_t (timeDelta - prevTimeDelta);
+
+  elapsedTime += diff; 
+  prevTimeDelta = timeDelta;
+}
+
+//==============================================================================//
+/**
+ * @brief Computes the output of the task at an arbitrary time without changing
+ * the task in any way. See ptSchedule::stateAt() for details.
+ * 
+ * @param time Time in microseconds since the first call.
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptScheduler:: stateAt (time_us_t time) const {
+  return schedule->stateAt (time);
+}
+
+//==============================================================================//
+/**
+ * @brief Computes the outputs of many tasks at many timestamps, without
+ * changing the tasks. See stateAt() for details. The result for task i at
+ * timestamp j is saved to states [(i * timeCount) + j]. The timestamps of each
+ * task are evaluated in one tight loop, so the compiler can unroll it. Tasks
+ * that share the schedule of the task before them reuse its results.
+ * 
+ * @param tasks Pointer to the array of tasks.
+ * @param taskCount Number of tasks.
+ * @param times Pointer to the array of timestamps, in microseconds since the first call.
+ * @param timeCount Number of timestamps.
+ * @param states Pointer to the output array of at least taskCount * timeCount elements.
+ */
+void ptScheduler:: stateAt (const ptScheduler* tasks, uint32_t taskCount, const time_us_t* times, uint32_t timeCount, bool* states) {
+  if ((tasks == nullptr) || (times == nullptr) || (states == nullptr)) {
+    return;
+  }
+
+  for (uint32_t i = 0; i < taskCount; i++) {
+    const ptSchedule* schedule = tasks [i].schedule;
+    bool* taskStates = states + (size_t (i) * timeCount);
+
+    if ((i > 0) && (schedule == tasks [i - 1].schedule)) {
+      memcpy (taskStates, taskStates - timeCount, timeCount * sizeof (bool));
+      continue;
+    }
+
+    for (uint32_t j = 0; j < timeCount; j++) {
+      taskStates [j] = schedule->stateAt (times [j]);
+    }
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Moves the entry time of the task back from the current time, so that
+ * the elapsed time of the ongoing interval (or skip duration) will be equal to
+ * the given value. The current time is saved in microsValue.
+ * 
+ * @param elapsed The elapsed time in microseconds.
+ */
+void ptScheduler:: rebaseTime (time_us_t elapsed) {
+  microsValue = GET_MICROS();
+  entryTime = time_us_t (microsValue) - elapsed;
+  elapsedTime = elapsed;
+  timeDelta = uint32_t (elapsed);
+  prevTimeDelta = timeDelta;
+}
+
+//==============================================================================//
+/**
+ * @brief Places the task at any point of its schedule, as if it had been running
+ * since the given time without any interruption. The time is counted from the
+ * start of the first interval; the skip duration is considered already elapsed.
+ * All counters and states are set to what they would have been at that time,
+ * including the end of finite repetitions. This takes the same time regardless
+ * of how far the task is moved.
+ * 
+ * @param time Position in the schedule in microseconds.
+ * @return true If the task was moved.
+ * @return false If the task is disabled, the sequence is empty or the task is a
+ * RATELIMIT or TRIGGERED task, which does not have a fixed schedule.
+ */
+bool ptScheduler:: seek (time_us_t time) {
+  if ((!taskEnabled) || (schedule->sequenceLength == 0) || ((schedule->taskMode != PT_MODE_ONESHOT) && (schedule->taskMode != PT_MODE_SPANNING))) {
+    return false;
+  }
+
+  uint64_t interval = schedule->getIntervalAt (time);
+  time_us_t elapsed = time - schedule->getIntervalStart (interval);
+  uint64_t endInterval = schedule->getEndInterval();
+  bool ended = (endInterval > 0) && (interval >= endInterval);
+
+  taskStarted = true;
+  cycleStarted = true;
+  taskSuspended = false;
+  updateCyclic();
+  sequenceRepetitionEnded = false;
+  suspendedIntervalCounter = (ended) ? (interval - endInterval) : 0;  // Keeps running while suspended
+  executionCounter = schedule->getExecutionsAt (time);
+  sequenceIndex = interval % schedule->sequenceLength;
+  rebaseTime (elapsed);
+
+  if (schedule->taskMode == PT_MODE_SPANNING) {
+    // The state toggles after each interval, starting with true.
+    // It keeps toggling while suspended.
+    intervalCounter = interval;
+    taskRunState = (ended) ? (((interval - endInterval) % 2) == 1) : ((interval % 2) == 0);
+    taskRunning = taskRunState;
+  }
+  else {
+    // A oneshot task returns true once at the start of every interval.
+    sequenceRepetitionCounter = (ended) ? schedule->sequenceRepetition : (interval / schedule->sequenceLength);
+  }
+
+  // Put the task to sleep if it has completed all its repetitions.
+  if (ended) {
+    if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+      disable();  // No counters will be running in disabled mode
+    }
+    else {
+      suspend();  // The suspended interval counter keeps running
+    }
+
+    taskRunning = false;
+    sequenceRepetitionEnded = true;
+  }
+
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Places the task at the start of an interval. See seek() for details.
+ * 
+ * @param interval The interval number, counted continuously across sequences.
+ * @return true If the task was moved.
+ * @return false If the task is disabled, the sequence is empty or the task is a
+ * RATELIMIT or TRIGGERED task, which does not have a fixed schedule.
+ */
+bool ptScheduler:: seekInterval (uint64_t interval) {
+  return seek (schedule->getIntervalStart (interval));
+}
+
+//==============================================================================//
+/**
+ * @brief Makes sure the task has its own copy of the schedule before it is
+ * changed. If the schedule is shared with other tasks, it is copied along with
+ * the interval sequence, and the task switches to the copy. Schedules owned by
+ * the task are changed in place. This is called by all functions that change the
+ * schedule through the task.
+ * 
+ * @return true If the schedule was copied.
+ * @return false If the task already owns its schedule.
+ */
+bool ptScheduler:: detachSchedule() {
+  if (!scheduleShared) {
+    return false;
+  }
+
+  ptSchedule* copy = copySchedule (*schedule);
+  releaseSchedule();
+  schedule = copy;
+  scheduleShared = false;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets up the runtime state of a task mode. RATELIMIT, TRIGGERED and
+ * CALENDAR tasks keep their state in the same memory, so it is set to the
+ * default values when the task starts using a different mode. This is called
+ * when the mode of the task is set, and by the mode functions and the setters of
+ * each mode. The values set for the previous mode are lost, so set the mode of
+ * the task before the values of the mode (like setRateLimit()). Nothing is
+ * changed if the state is already set up for the mode.
+ * 
+ * @param mode The task mode.
+ */
+void ptScheduler:: prepareModeState (uint8_t mode) {
+  if (stateMode == mode) {
+    return;
+  }
+
+  switch (mode) {
+    case PT_MODE_RATELIMIT:
+      rateLimitState.permitsPerInterval = 1;
+      rateLimitState.burstCapacity = 1;
+      rateLimitState.permitCredit = 0;
+      rateLimitState.permitsGranted = 0;
+      rateLimitState.permitsDenied = 0;
+      break;
+
+    case PT_MODE_TRIGGERED:
+      triggerState.triggerCount = 0;
+      triggerState.triggerCountSeen = 0;
+      triggerState.triggersRequired = 1;
+      triggerState.triggerCountLast = 0;
+      triggerState.eventTime = 0;
+      triggerState.holdoffTime = 0;
+      triggerState.debounceTime = 0;
+      triggerState.timedOut = false;
+      triggerState.runTime = 0;
+      break;
+
+    case PT_MODE_CALENDAR:
+      calendarState.clockSource = nullptr;
+      calendarState.clockTime = 0;
+      calendarState.nextFireTime = 0;
+      calendarState.lastFireTime = 0;
+      break;
+
+    default:  // ONESHOT and SPANNING tasks only use the common state
+      break;
+  }
+
+  stateMode = mode;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the measurements of the task, allocating them on the first
+ * call. Tasks only get a profile when it is needed; by setTrace(), complete(),
+ * setSlackTime() or a ptCoalescer. The lateness of ONESHOT and SPANNING tasks is
+ * only measured if the task has a profile, so call this once if you want to read
+ * the lateness of a task that does not have one yet.
+ * 
+ * @return ptTaskProfile* The profile of the task.
+ */
+ptTaskProfile* ptScheduler:: getProfile() {
+  if (profile == nullptr) {
+    profile = new ptTaskProfile;
+  }
+  return profile;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets or clears the bit of the task in the enabled mask of the ptCyclic
+ * it was added to, so that the cyclic executive does not have to check every
+ * task in every frame. Called whenever the task is enabled, disabled, suspended
+ * or resumed.
+ * 
+ */
+void ptScheduler:: updateCyclic() {
+  if ((profile == nullptr) || (profile->cyclic == nullptr)) {
+    return;
+  }
+
+  uint32_t taskBit = uint32_t (1) << profile->cyclicIndex;
+
+  if (taskEnabled && (!taskSuspended)) {
+    profile->cyclic->enabledMask |= taskBit;
+  }
+  else {
+    profile->cyclic->enabledMask &= ~taskBit;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Switches the task to a shared schedule. The schedule is not copied; see
+ * ptScheduler (const ptSchedule&). All runtime states of the task are reset and
+ * the task is enabled if the schedule has intervals. If the task owned its
+ * previous schedule, that schedule is freed.
+ * 
+ * @param sharedSchedule The schedule to use.
+ */
+void ptScheduler:: setSchedule (const ptSchedule& sharedSchedule) {
+  disable();  // Clear all runtime states
+
+  if (schedule != &sharedSchedule) {
+    releaseSchedule();  // Free the schedule the task owned
+    schedule = (ptSchedule*) &sharedSchedule;
+    scheduleShared = true;
+  }
+
+  prepareModeState (schedule->taskMode);
+
+  if (schedule->sequenceLength > 0) {
+    enable();
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Allows you to change modes dynamically. See ptSchedule::setTaskMode().
+ * inputError is set to true in case of input error.
+ * 
+ * @param mode The task working mode. Can be PT_MODE_ONESHOT, PT_MODE_SPANNING, PT_MODE_RATELIMIT, PT_MODE_TRIGGERED or PT_MODE_CALENDAR.
+ * @return true Mode is valid.
+ * @return false Mode is invalid.
+ */
+bool ptScheduler:: setTaskMode (uint8_t mode) {
+  detachSchedule();
+
+  if (schedule->setTaskMode (mode)) {
+    prepareModeState (mode);
+    return true;
+  }
+
+  inputError = true;  // when the user has made a mistake
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets what the task does after completing its sequence repetitions.
+ * See ptSchedule::setSleepMode(). inputError is set to true in case of input
+ * error.
+ * 
+ * @param mode The task sleep mode. Can be PT_SLEEP_DISABLE or PT_SLEEP_SUSPEND.
+ * @return true Mode is valid.
+ * @return false Mode is invalid.
+ */
+bool ptScheduler:: setSleepMode (uint8_t mode) {
+  detachSchedule();
+
+  if (schedule->setSleepMode (mode)) {
+    return true;
+  }
+
+  inputError = true;
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Determines whether a task should run or not. Enclose this function
+ * call in any conditional clause to run the code block. Do not use any other
+ * blocking delays inside or outside those blocks, which will defeat the 
+ * purpose of this library.
+ * 
+ * For Oneshot tasks, the return state will be true only momentarily, after
+ * an interval is elapsed. This allows you to run code blocks only once in
+ * a given interval. For Spanning tasks, the return state will persist until
+ * the ongoing interval is ended. For Ratelimit tasks, the return state will be
+ * true if a permit is available; call it only when you want to do the work.
+ * For Triggered tasks, the return state will be true once after the task is
+ * triggered. For Calendar tasks, the return state will be true once when the
+ * wall clock reaches a fire time.
+ * 
+ * Every time a task executes, all of its dependent tasks are triggered. Every
+ * time the output changes, the edge callbacks are called.
+ * 
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptScheduler:: call() {
+  // Tasks without an interval sequence can not run.
+  if (schedule->sequenceLength == 0) {
+    return false;
+  }
+
+  uint64_t executions = executionCounter;
+  bool result = false;
+
+  switch (schedule->taskMode) {
+    case PT_MODE_ONESHOT:
+      result = oneshot();
+      break;
+
+    case PT_MODE_SPANNING:
+      result = spanning();
+      break;
+
+    case PT_MODE_RATELIMIT:
+      result = ratelimit();
+      break;
+
+    case PT_MODE_TRIGGERED:
+      result = triggered();
+      break;
+
+    case PT_MODE_CALENDAR:
+      result = calendar();
+      break;
+
+    default:
+      break;
+  }
+
+  // Trigger the dependent tasks every time this task executes.
+  if ((profile != nullptr) && (profile->dependentCount > 0) && (executionCounter > executions)) {
+    for (uint8_t i = 0; i < profile->dependentCount; i++) {
+      profile->dependentList [i]->trigger();
+    }
+  }
+
+  // Save the start time of the work, so that complete() can measure the run duration.
+  if (executionCounter > executions) {
+    runStartTime = GET_MICROS();
+
+    if ((profile != nullptr) && (profile->trace != nullptr)) {
+      profile->trace->record (profile->taskId, PT_TRACE_FIRE, runStartTime);
+    }
+  }
+
+  if ((profile != nullptr) && (profile->trace != nullptr) && (result != lastCallState)) {
+    profile->trace->record (profile->taskId, (result) ? PT_TRACE_RISE : PT_TRACE_FALL, GET_MICROS());
+  }
+
+  bool isEdge = (result != lastCallState);
+  lastCallState = result;
+
+  // Report the edges of the output to the callbacks, if any.
+  if (isEdge && (profile != nullptr)) {
+    if (result && (profile->risingCallback != nullptr)) {
+      profile->risingCallback (*this);
+    }
+    else if ((!result) && (profile->fallingCallback != nullptr)) {
+      profile->fallingCallback (*this);
+    }
+  }
+
+  return result;
+}
+
+//==============================================================================//
+/**
+ * @brief Calls the task and reports the changes of its output, instead of the
+ * output level. Use this in place of call() if you only want to do work when the
+ * output changes. For example, a SPANNING task that blinks an LED returns true for
+ * the whole ON interval, but edge() returns PT_EDGE_RISING only once at the start
+ * of it and PT_EDGE_FALLING only once at the end. No previous state has to be kept
+ * in your code. The edge callbacks (see setEdgeCallbacks()) are called as well.
+ * 
+ * For ONESHOT tasks, every execution is a rising edge followed by a falling edge
+ * on the next call.
+ * 
+ * @return uint8_t PT_EDGE_RISING, PT_EDGE_FALLING or PT_EDGE_NONE.
+ */
+uint8_t ptScheduler:: edge() {
+  bool previousState = lastCallState;
+  bool state = call();
+
+  if (state == previousState) {
+    return PT_EDGE_NONE;
+  }
+  return (state) ? PT_EDGE_RISING : PT_EDGE_FALLING;
+}
+
+//==============================================================================//
+/**
+ * @brief Implements the SPANNING task logic. The return state of a spanning
+ * task will persist until the ongoing interval is ended. If you set the state
+ * to true and wait for 2 seconds, then the sate will remain true until 2
+ * seconds are passed. This is unlike ONESHOT logic which returns true only
+ * momentarily.
+ * 
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptScheduler:: spanning() {
+  uint8_t intervalScale = getIntervalScale();
+
+  if (taskEnabled && (schedule->sequenceLength > 0)) {
+    // If an execution cycle has not started yet, defer the task until the time set by the
+    // user (called skip time). The user can specify the skip time in terms of time, sequence
+    // or interval.
+    if ((!taskStarted) && (schedule->skipIntervalSet || schedule->skipSequenceSet || schedule->skipTimeSet)) {
+      if (entryTime == 0) { // this is one way to find if an execution cycle has not started
+        elapsedTime = 0;
+        entryTime = GET_MICROS();
+        return false;
+      }
+      else {
+        elapsedTime = GET_MICROS() - entryTime;
+
+        if (elapsedTime < schedule->skipTime) { // skipTime is set when skip time or skip interval is set
+          return false;
+        }
+        else {
+          taskStarted = true;
+          taskRunState = true;
+        }
+      }
+    }
+
+    // If an interval cycle has not started yet, then initialize all variables with
+    // a known default state. We also save the entry time at this time.
+    // For spanning tasks, this only happens once.
+    if (!cycleStarted) {
+      taskRunState = true;
+      taskRunning = true;
+      executionCounter++; // This increments before the interval counter
+      elapsedTime = 0;  // Reset so that we can start a new cycle
+      prevTimeDelta = 0;
+      entryTime = GET_MICROS(); // Get the entry time
+      cycleStarted = true;
+      sequenceRepetitionEnded = false;
+      taskStarted = true;
+      sequenceIndex = 0;
+      intervalCounter = 0;
+      // printStats();
+    }
+    else {  // If an interval cycle has started
+      getTimeElapsed();  // Get the elapsed time since entry time
+
+      if (elapsedTime >= (schedule->sequenceList [sequenceIndex] * intervalScale)) { // Check if the elapsed time is greater than an interval in the sequence list.
+        time_us_t leftover = elapsedTime - (schedule->sequenceList [sequenceIndex] * intervalScale);  // How late the end of the interval was found
+        recordLateness (leftover);
+
+        // If more than one interval has elapsed since the last poll (because the loop stalled,
+        // for example), catch up with all of them in one step.
+        uint64_t elapsedIntervals = getElapsedIntervals();
+
+        if (elapsedIntervals > 1) {
+          return resync (elapsedIntervals);
+        }
+
+        if (sequenceIndex < (schedule->sequenceLength - 1)) { // Move to the next interval in the sequence list.
+          sequenceIndex++;
+        }
+        else { // Else reset to the first interval in the sequence list.
+          sequenceIndex = 0;
+        }
+
+        intervalCounter++; // Counter increments after an interval (not sequence) is completed.
+
+        if (profile != nullptr) {
+          profile->exitTime = entryTime + elapsedTime; // Save the exit time
+          profile->lastElapsedTime = elapsedTime;
+        }
+
+        // The next interval started when the last one ended, not now. Keep the time left over
+        // from the ended interval, so that the task stays in phase however late it was polled.
+        entryTime = time_us_t (microsValue) - leftover;
+        elapsedTime = leftover;
+        prevTimeDelta = uint32_t (leftover);
+        timeDelta = prevTimeDelta;
+
+        if (taskSuspended) { // If the task gets suspended.
+          // printStats();
+          suspendedIntervalCounter++; // Counts how long a task remains suspended.
+          
+          // The following line restores a suspended task to the same state during which it was suspended.
+          // Without this, the states may be swapped after resuming a task.
+          taskRunState = (taskRunState) ? false : true; // Toggle the state
+          
+          // If you want pulses on rising and falling edges, use edge() instead of call().
+          return false;
+        }
+
+        if (!taskSuspended) { // If the task is still active.
+          if (schedule->sequenceRepetition > 0) { // If this is a finite repetition task.
+            if (executionCounter >= schedule->sequenceRepetitionExtended) { // Check if the task has completed all its repetitions.
+              // If yes, put the task to sleep; either DISABLE or SUSPEND.
+              if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+                // No counters will be running in disabled mode
+                disable();
+              }
+              else {
+                // But in suspend mode, some counters will be running
+                // which allows you to resume the task based on how long it has been suspended.
+                suspend();
+              }
+              
+              // intervalCounter = 0;
+              taskRunState = false;
+              taskRunning = false;
+              sequenceRepetitionEnded = true;
+              suspendedIntervalCounter = 0;
+              // sequenceIndex = 0;  // You have to manually reset this, if you want
+              return false;
+            }
+          }
+
+          // Determine the next state of the task. Since we are here because an interval has ended,
+          // we can toggle the task state.
+          taskRunState = (taskRunState) ? false : true;
+
+          // If the task state is true, then we can also increment the execution counter.
+          // The execution counter keeps track of how many times the task has been executed (returned true).
+          if (taskRunState) {
+            executionCounter++;
+            taskRunning = true;
+            // printStats();
+          }
+          else {
+            taskRunning = false;
+          }
+        }
+      }
+    }
+
+    // If the task is not suspended, persist the state until the interval ends.
+    if (!taskSuspended) {
+      return taskRunState;
+    }
+
+    // If the task is in suspended mode, always return false.
+    return false;
+  }
+
+  else { // If the task is not enabled.
+    return false;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the number of intervals that have ended since the entry time
+ * of the ongoing interval, based on the current elapsedTime. This is found from
+ * the prefix sums, regardless of how many intervals have ended. Intervals
+ * stretched by setIntervalScale() are taken into account.
+ * 
+ * @return uint64_t Number of intervals ended.
+ */
+uint64_t ptScheduler:: getElapsedIntervals() {
+  uint8_t intervalScale = getIntervalScale();
+
+  if (schedule->sequencePeriod == 0) {  // Only zero-length intervals; step one by one
+    return (elapsedTime >= (schedule->sequenceList [sequenceIndex] * intervalScale)) ? 1 : 0;
+  }
+
+  return schedule->getIntervalAt (schedule->getIntervalStart (sequenceIndex) + (elapsedTime / intervalScale)) - sequenceIndex;
+}
+
+//==============================================================================//
+/**
+ * @brief Advances a SPANNING or ONESHOT task by a number of ended intervals in
+ * one step. The sequence index, run state, interval counter, execution counter,
+ * sequence repetition counter and the suspended interval counter are set to the
+ * same values they would have if the intervals were ended one by one. This
+ * includes putting the task to sleep at the end of finite repetitions. The time
+ * left over from the last ended interval is kept, so the task stays in phase.
+ * A ONESHOT task starts the next interval as soon as one ends; the runs at the
+ * starts of the intervals are counted, but not returned.
+ * 
+ * spanning() calls this automatically when it finds more than one interval has
+ * ended since the last poll. If you call it yourself, call getTimeElapsed() right
+ * before it, since the leftover time is counted from the last measurement.
+ * 
+ * @param intervals Number of ended intervals.
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptScheduler:: resync (uint64_t intervals) {
+  if (intervals == 0) {
+    return (taskSuspended || (schedule->taskMode == PT_MODE_ONESHOT)) ? false : taskRunState;
+  }
+
+  // The position is found in unstretched time, and the remainder is added back later.
+  uint8_t intervalScale = getIntervalScale();
+  time_us_t position = schedule->getIntervalStart (sequenceIndex) + (elapsedTime / intervalScale);
+  time_us_t remainder = elapsedTime % intervalScale;
+  uint8_t firstIndex = sequenceIndex;  // The interval that was ongoing
+
+  uint64_t nextInterval = sequenceIndex + intervals;
+  sequenceIndex = nextInterval % schedule->sequenceLength;
+
+  if (profile != nullptr) {
+    profile->exitTime = entryTime + elapsedTime;
+    profile->lastElapsedTime = elapsedTime;
+  }
+
+  // Keep the leftover time. The new entry time is counted from the time elapsedTime was measured at.
+  time_us_t leftover = ((position - schedule->getIntervalStart (nextInterval)) * intervalScale) + remainder;
+  entryTime = time_us_t (microsValue) - leftover;
+  elapsedTime = leftover;
+  prevTimeDelta = uint32_t (leftover);
+  timeDelta = prevTimeDelta;
+
+  if (schedule->taskMode == PT_MODE_ONESHOT) {
+    // Every ended interval is followed by the start of a new one. The sequence repetition
+    // counter increments at the end of every sequence, while the task is not suspended.
+    if (taskSuspended) {
+      suspendedIntervalCounter += intervals;
+      return false;
+    }
+
+    uint64_t sleepInterval = intervals + 1; // The ended interval after which the task goes to sleep
+
+    // The task goes to sleep at the first start of an interval after completing all its repetitions.
+    if (schedule->sequenceRepetition > 0) {
+      uint64_t remaining = (sequenceRepetitionCounter < schedule->sequenceRepetition) ?
+                           (schedule->sequenceRepetition - sequenceRepetitionCounter) : 0;
+      uint64_t endInterval = remaining * schedule->sequenceLength;  // Counted from the start of the ongoing sequence
+      sleepInterval = (endInterval > firstIndex) ? (endInterval - firstIndex) : 1;
+    }
+
+    if (sleepInterval > intervals) {
+      executionCounter += intervals;
+      sequenceRepetitionCounter += nextInterval / schedule->sequenceLength;
+      return false;
+    }
+
+    executionCounter += sleepInterval - 1;
+    sequenceRepetitionCounter += (firstIndex + sleepInterval) / schedule->sequenceLength;
+
+    if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+      disable();
+      return false;
+    }
+
+    suspend();
+    sequenceRepetitionEnded = true;
+    suspendedIntervalCounter = intervals - sleepInterval; // The rest of the intervals are spent in suspended state
+    return false;
+  }
+
+  intervalCounter += intervals;
+  uint64_t activeIntervals = intervals;  // Intervals ended before the task goes to sleep
+  bool toSleep = false;
+
+  // If this is a finite repetition task, find the interval at which the task would
+  // complete all its repetitions. The check happens at the end of every interval
+  // before toggling the state, and the execution counter increments on every rising state.
+  if ((!taskSuspended) && (schedule->sequenceRepetition > 0)) {
+    uint64_t sleepInterval = 1;
+
+    if (executionCounter < schedule->sequenceRepetitionExtended) {
+      uint64_t remaining = schedule->sequenceRepetitionExtended - executionCounter;
+      sleepInterval = (taskRunState ? (2 * remaining) : ((2 * remaining) - 1)) + 1;
+    }
+
+    if (sleepInterval <= intervals) {
+      activeIntervals = sleepInterval;
+      toSleep = true;
+    }
+  }
+
+  if (taskSuspended) {
+    suspendedIntervalCounter += intervals;
+    taskRunState = taskRunState ^ ((intervals % 2) == 1);
+    return false;
+  }
+
+  if (toSleep) {
+    // The state toggled on every interval except the last one, which put the task to sleep.
+    uint64_t toggles = activeIntervals - 1;
+    executionCounter += (taskRunState ? (toggles / 2) : ((toggles + 1) / 2));
+
+    if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+      disable();
+      return false;
+    }
+
+    suspend();
+    taskRunState = false;
+    taskRunning = false;
+    sequenceRepetitionEnded = true;
+
+    // The rest of the intervals are spent in suspended state.
+    suspendedIntervalCounter = intervals - activeIntervals;
+    taskRunState = ((suspendedIntervalCounter % 2) == 1);
+    return false;
+  }
+
+  // The execution counter increments on every rising state.
+  executionCounter += (taskRunState ? (intervals / 2) : ((intervals + 1) / 2));
+  taskRunState = taskRunState ^ ((intervals % 2) == 1);
+  taskRunning = taskRunState;
+  return taskRunState;
+}
+
+//==============================================================================//
+/**
+ * @brief Implements the logic of ONESHOT tasks. ONESHOT returns true momentarily during the
+ * rising edge of an interval.
+ * 
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptScheduler:: oneshot() {
+  uint8_t intervalScale = getIntervalScale();
+
+  if (taskEnabled && (schedule->sequenceLength > 0)) {
+    // If an execution cycle has not started yet, defer the task until the time set by the
+    // user (called skip time). The user can specify the skip time in terms of time, sequence
+    // or interval.
+    if ((!taskStarted)) {
+      if (schedule->skipIntervalSet || schedule->skipSequenceSet || schedule->skipTimeSet) {
+        if (entryTime == 0) { // This is one way to find if an execution cycle has not started.
+          elapsedTime = 0;
+          entryTime = GET_MICROS(); // Get the entry time.
+          return false;
+        }
+        else { // If we have already entered the skip duration.
+          if ((GET_MICROS() - entryTime) < schedule->skipTime) {
+            return false;
+          }
+          else {
+            taskStarted = true; // Start the task after the skip duration is elapsed.
+          }
+        }
+      }
+    }
+
+    // Start a new interval cycle, if it has not already.
+    // We get a true signal every time an interval starts.
+    // If you don't want a oneshot task to be executed at the start of a new interval cycle,
+    // then simply set a skip time.
+    if (!cycleStarted) {
+      microsValue = GET_MICROS();
+      time_us_t lateness = 0;
+
+      // If the task is kept in phase (it has a slack time or was added to a ptCoalescer) and
+      // the last interval was found ended late, the new interval started when the last one
+      // ended (saved as the entry time), not now. The lateness is kept, so that the rate of the
+      // task stays the same. If the task was late by a whole interval or more, it starts afresh.
+      // Other tasks count the new interval from now, as it has always been.
+      if ((profile != nullptr) && (profile->exitTime != 0) && ((profile->slackTime > 0) || profile->coalesced)) {
+        lateness = uint32_t (microsValue - entryTime);
+
+        if (lateness >= (schedule->sequenceList [sequenceIndex] * intervalScale)) {
+          lateness = 0;
+        }
+      }
+
+      elapsedTime = lateness;
+      prevTimeDelta = uint32_t (lateness);
+      timeDelta = prevTimeDelta;
+      entryTime = time_us_t (microsValue) - lateness; // Get the entry time.
+      cycleStarted = true;
+      // intervalCounter++;
+
+      // If the tasks gets suspended, always return false.
+      // But also increment the suspended interval counter so that we can use it to
+      // resume the task.
+      if (taskSuspended) {
+        suspendedIntervalCounter++;
+        return false;
+      }
+
+      // This is the return point that gives you green signal each time.
+      if (!taskSuspended) {
+        // Check if this is a finite repetition task.
+        // If yes, we must either disable or suspend the task after the specified number of repetitions.
+        if (schedule->sequenceRepetition > 0) {
+          if (sequenceRepetitionCounter >= schedule->sequenceRepetition) {
+            if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+              disable(); // Interval counter will not run in this mode.
+            }
+            else {
+              // This is the self-suspend mode.
+              // Interval counter runs and you can resume the task when you need.
+              suspend();
+            }
+
+            // A sequence is not considered ended until all of the intervals have been elapsed.
+            // Oneshot tasks return true at the start of an interval. Therefore, execution counter
+            // being equal to sequenceRepetition does not mean the last interval is elapsed.
+            // Therefore, the last execution cycle of a oneshot sequence would not return this variable
+            // as true. It will be only true after the last interval in the sequence has elapsed.
+            sequenceRepetitionEnded = true;
+
+            // The suspended interval counter is reset at this point so that any subsequent
+            // invocation of the task will increment it from 0.
+            suspendedIntervalCounter = 0;
+
+            // We return false because the task is now either disabled or suspended.
+            return false;
+          }
+        }
+        executionCounter++;
+        return true;
+      }
+    }
+
+    // If an interval cycle has already started, then we need to check if the interval has ended or not.
+    if (cycleStarted) {
+      getTimeElapsed();
+
+      // If the current interval in the sequence list is not elapsed.
+      if (elapsedTime < (schedule->sequenceList [sequenceIndex] * intervalScale)) {
+        return false;
+      }
+
+      time_us_t interval = schedule->sequenceList [sequenceIndex] * intervalScale;
+      recordLateness (elapsedTime - interval);
+
+      // If the current interval in the sequence is elapsed.
+      if (sequenceIndex < (schedule->sequenceLength - 1)) { // Check if we have reached the end of the list.
+        sequenceIndex++; // If not, move to the next interval.
+      }
+      else { // If all intervals in the sequence have been elapsed.
+        sequenceIndex = 0;
+        // sequenceRepetition counter should only increment when the task in not in suspended state.
+        if (!taskSuspended) {
+          sequenceRepetitionCounter++;
+        }
+      }
+
+      cycleStarted = false; // Reset so that we can start a new interval cycle.
+
+      if (profile != nullptr) {
+        profile->exitTime = entryTime + elapsedTime; // Save the exit time.
+        profile->lastElapsedTime = elapsedTime;
+      }
+      entryTime += interval;  // The time the interval ended, where the next one starts
+      return false;
+    }
+  }
+
+  else {
+    return false; //if not activated
+  }
+
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the time in microseconds, without the wrap around of micros()
+ * every 71 minutes. The upper part is taken from millis(), so the value only
+ * wraps around with millis(), every 49 days. Compare these values with
+ * getLongMicrosSince().
+ * 
+ * @return time_us_t Time in microseconds.
+ */
+static time_us_t getLongMicros() {
+  time_us_t estimate = time_us_t (uint32_t (GET_MILLIS())) * PT_MS_MULTIPLIER;
+  uint32_t microsNow = GET_MICROS();
+  return estimate + int32_t (microsNow - uint32_t (estimate));  // micros() gives the exact low part
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the time elapsed between two values of getLongMicros(), even
+ * if millis() wrapped around in between.
+ * 
+ * @param now The later time.
+ * @param start The earlier time.
+ * @return time_us_t Elapsed time in microseconds.
+ */
+static time_us_t getLongMicrosSince (time_us_t now, time_us_t start) {
+  time_us_t elapsed = now - start;
+
+  if (now < start) {  // millis() wrapped around
+    elapsed += time_us_t (0x100000000ULL) * PT_MS_MULTIPLIER;
+  }
+  return elapsed;
+}
+
+//==============================================================================//
+/**
+ * @brief Adds the permits a RATELIMIT task earns in some time, up to the burst
+ * capacity. The time is capped at the time it takes to fill the bucket before
+ * it is converted to permits, so that long times can not overflow the credit.
+ * 
+ * @param elapsed Time in microseconds.
+ */
+void ptScheduler:: refillPermits (time_us_t elapsed) {
+  time_us_t capacity = time_us_t (rateLimitState.burstCapacity) * schedule->sequenceList [0];
+
+  if (rateLimitState.permitCredit >= capacity) {
+    rateLimitState.permitCredit = capacity;
+    return;
+  }
+
+  time_us_t fillTime = ((capacity - rateLimitState.permitCredit) + rateLimitState.permitsPerInterval - 1) / rateLimitState.permitsPerInterval;
+
+  if (elapsed >= fillTime) {
+    rateLimitState.permitCredit = capacity;
+  }
+  else {
+    rateLimitState.permitCredit += elapsed * rateLimitState.permitsPerInterval;
+
+    if (rateLimitState.permitCredit > capacity) {
+      rateLimitState.permitCredit = capacity;
+    }
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Implements the logic of RATELIMIT tasks. A rate limit task works like a
+ * token bucket. It grants up to permitsPerInterval permits in every interval,
+ * and can save up to burstCapacity unused permits for later bursts. The bucket
+ * starts full. Permits are added lazily from the time elapsed since the last
+ * call, so nothing has to be done in between calls. That time is measured with
+ * the help of millis(), so it is right even if the task is not called for more
+ * than the 71 minutes it takes micros() to wrap around. Call this only when you
+ * want to do the rate limited work (like sending a message), since every false
+ * return is counted as a denied permit.
+ * 
+ * @return true A permit was granted.
+ * @return false No permit available.
+ */
+bool ptScheduler:: ratelimit() {
+  prepareModeState (PT_MODE_RATELIMIT);
+
+  if (taskEnabled && (schedule->sequenceLength > 0)) {
+    time_us_t permitCost = schedule->sequenceList [0];  // Time needed to earn a permit, at one permit per interval
+    time_us_t capacity = time_us_t (rateLimitState.burstCapacity) * permitCost;
+
+    if (!taskStarted) { // Start with a full bucket.
+      taskStarted = true;
+      rateLimitState.permitCredit = capacity;
+      entryTime = getLongMicros();
+    }
+    else {
+      time_us_t now = getLongMicros();
+      refillPermits (getLongMicrosSince (now, entryTime));  // Add the permits earned since the last call
+      entryTime = now;
+    }
+
+    // Suspended tasks keep earning permits, but can not use them.
+    if (taskSuspended) {
+      return false;
+    }
+
+    // Check if this is a finite repetition task.
+    if ((schedule->sequenceRepetition > 0) && (rateLimitState.permitsGranted >= schedule->sequenceRepetition)) {
+      if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+        disable();
+      }
+      else {
+        suspend();
+      }
+      sequenceRepetitionEnded = true;
+      return false;
+    }
+
+    if (rateLimitState.permitCredit >= permitCost) {
+      rateLimitState.permitCredit -= permitCost;
+      rateLimitState.permitsGranted++;
+      executionCounter++;
+      return true;
+    }
+
+    rateLimitState.permitsDenied++;
+    return false;
+  }
+
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the rate of a RATELIMIT task. The interval of the task is the
+ * period over which the permits are granted.
+ * 
+ * @param permits Number of permits granted per interval. Must be greater than 0.
+ * @param burst Maximum number of permits that can be saved up. Must be greater than 0.
+ * @return true If the values are set.
+ * @return false If the values are invalid.
+ */
+bool ptScheduler:: setRateLimit (uint32_t permits, uint32_t burst) {
+  if ((permits == 0) || (burst == 0)) {
+    inputError = true;
+    return false;
+  }
+
+  prepareModeState (PT_MODE_RATELIMIT);
+  rateLimitState.permitsPerInterval = permits;
+  rateLimitState.burstCapacity = burst;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Implements the logic of TRIGGERED tasks. A triggered task runs when it
+ * receives the required number of triggers (see setTriggerCount()), either from
+ * trigger() or from another task it depends on. The trigger can be an external
+ * event such as a pin change, signalled from an ISR. The timing of the runs can
+ * be controlled in the following ways.
+ * 
+ * Interval - If the interval of the task is not 0, the task also runs when no
+ * trigger has been received for that long. This makes the task run at least once
+ * every interval. timedOut is set to true if a run was caused by the interval.
+ * 
+ * Hold-off time - The minimum time between two runs. Triggers received during the
+ * hold-off time are combined into one run at the end of it.
+ * 
+ * Debounce time - The task only runs after no new triggers have been received
+ * for this long. A burst of triggers (like a bouncing switch) causes one run.
+ * 
+ * Skip time - The task waits this long after starting a run before returning true.
+ * 
+ * Triggers received while the task is suspended are dropped.
+ * 
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptScheduler:: triggered() {
+  prepareModeState (PT_MODE_TRIGGERED);
+
+  if (taskEnabled && (schedule->sequenceLength > 0)) {
+    microsValue = GET_MICROS();
+
+    // The interval and the hold-off time are counted from the first call.
+    if (!cycleStarted) {
+      cycleStarted = true;
+      triggerState.runTime = microsValue;
+      triggerState.triggerCountLast = __atomic_load_n (&triggerState.triggerCount, __ATOMIC_RELAXED);
+    }
+
+    // The trigger counter can be incremented from an ISR or another thread, so we only read it here.
+    uint8_t currentCount = __atomic_load_n (&triggerState.triggerCount, __ATOMIC_RELAXED);
+
+    // Every new trigger restarts the debounce time.
+    if (currentCount != triggerState.triggerCountLast) {
+      triggerState.triggerCountLast = currentCount;
+      triggerState.eventTime = microsValue;
+    }
+
+    // Check if we can start a run.
+    if (!taskStarted) {
+      uint8_t pendingTriggers = uint8_t (currentCount - triggerState.triggerCountSeen);
+      uint32_t timeSinceRun = uint32_t (microsValue - triggerState.runTime);
+      bool isTriggered = (pendingTriggers >= triggerState.triggersRequired) &&
+                         (uint32_t (microsValue - triggerState.eventTime) >= triggerState.debounceTime);
+      bool isTimedOut = (schedule->sequenceList [0] > 0) && (timeSinceRun >= schedule->sequenceList [0]);
+
+      if ((!isTriggered && !isTimedOut) || (timeSinceRun < triggerState.holdoffTime)) {
+        return false;
+      }
+
+      // All complete sets of pending triggers are combined into this run.
+      triggerState.triggerCountSeen += pendingTriggers - (pendingTriggers % triggerState.triggersRequired);
+      triggerState.timedOut = !isTriggered;
+      triggerState.runTime = microsValue;
+      taskStarted = true;
+      entryTime = microsValue; // The delay is counted from here
+    }
+
+    // Wait for the skip time after the trigger.
+    if ((schedule->skipIntervalSet || schedule->skipSequenceSet || schedule->skipTimeSet) && (uint32_t (microsValue - entryTime) < schedule->skipTime)) {
+      return false;
+    }
+
+    taskStarted = false;  // Wait for the next trigger
+
+    if (taskSuspended) {  // The trigger is dropped
+      suspendedIntervalCounter++;
+      return false;
+    }
+
+    // Check if this is a finite repetition task.
+    if ((schedule->sequenceRepetition > 0) && (executionCounter >= schedule->sequenceRepetition)) {
+      if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+        disable();
+      }
+      else {
+        suspend();
+      }
+      sequenceRepetitionEnded = true;
+      return false;
+    }
+
+    executionCounter++;
+    return true;
+  }
+
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Triggers a TRIGGERED task. This only increments a counter, so it is
+ * safe to call from an ISR. The increment is atomic, so triggers are not lost
+ * when an ISR or another thread triggers the task at the same time as the main
+ * loop. On cores without atomic byte instructions (like AVR, ARMv6-M and the
+ * ESP8266), the interrupts are disabled around the increment. Up to 255 triggers
+ * can be pending at a time. Tasks in other modes ignore the triggers.
+ * 
+ */
+void ptScheduler:: trigger() {
+  // Only TRIGGERED tasks count the triggers; see prepareModeState().
+  if (stateMode != PT_MODE_TRIGGERED) {
+    return;
+  }
+
+#if defined (__AVR__)
+  // AVR has no atomic read-modify-write instructions, so the interrupts are disabled instead.
+  uint8_t oldSREG = SREG;
+  cli();
+  triggerState.triggerCount++;
+  SREG = oldSREG;
+#elif (__GCC_ATOMIC_CHAR_LOCK_FREE == 2)
+  __atomic_fetch_add (&triggerState.triggerCount, 1, __ATOMIC_RELAXED);
+#elif defined (ESP8266)
+  // Cores without atomic byte instructions would need a library call they don't provide,
+  // so the interrupts are disabled instead, and restored to the level they were at.
+  uint32_t savedPS = xt_rsil (15);
+  triggerState.triggerCount++;
+  xt_wsr_ps (savedPS);
+#elif defined (__ARM_ARCH_6M__)
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  triggerState.triggerCount++;
+  __set_PRIMASK (primask);
+#else
+  noInterrupts();
+  triggerState.triggerCount++;
+  interrupts();
+#endif
+}
+
+//==============================================================================//
+/**
+ * @brief Adds a task to be triggered every time this task executes, forming a
+ * chain like "sample -> filter -> publish". The dependent task is usually a
+ * TRIGGERED task, and will run on its next call. Call the tasks in the order of
+ * the chain, so that the dependent task runs in the same loop as this task.
+ * A task can depend on more than one task; see setTriggerCount() to wait for all
+ * of them. For example, "sample -> publish" and "sample -> filter -> publish" with
+ * a trigger count of 2 for publish. Dependencies that would form a loop are rejected.
+ * 
+ * @param task The dependent task.
+ * @return true If the task was added.
+ * @return false If the task would form a loop or is already a direct dependent.
+ */
+bool ptScheduler:: addDependent (ptScheduler& task) {
+  uint8_t dependentCount = (profile != nullptr) ? profile->dependentCount : 0;
+
+  // A loop is formed if this task is already triggered by the new dependent.
+  if ((&task == this) || task.hasDependent (*this) || (dependentCount == 255)) {
+    inputError = true;
+    return false;
+  }
+
+  // Only direct duplicates are rejected. The task may also be triggered through other
+  // dependents, like the joining task of a diamond.
+  for (uint8_t i = 0; i < dependentCount; i++) {
+    if (profile->dependentList [i] == &task) {
+      inputError = true;
+      return false;
+    }
+  }
+
+  ptTaskProfile* links = getProfile();
+  ptScheduler** list = new ptScheduler* [dependentCount + 1];
+
+  for (uint8_t i = 0; i < dependentCount; i++) {
+    list [i] = links->dependentList [i];
+  }
+  list [dependentCount] = &task;
+
+  if (links->dependentList != nullptr) {
+    delete [] links->dependentList;
+  }
+
+  links->dependentList = list;
+  links->dependentCount++;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Checks if a task is triggered by this task, directly or through
+ * other dependent tasks.
+ * 
+ * @param task The task to find.
+ * @return true If the task is a dependent.
+ * @return false If the task is not a dependent.
+ */
+bool ptScheduler:: hasDependent (const ptScheduler& task) const {
+  if (profile == nullptr) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < profile->dependentCount; i++) {
+    if ((profile->dependentList [i] == &task) || profile->dependentList [i]->hasDependent (task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the number of triggers a TRIGGERED task needs to run once. If a
+ * task depends on two other tasks and should run after both of them have
+ * executed, set this to 2.
+ * 
+ * @param count Number of triggers. Must be greater than 0.
+ * @return true If the value is set.
+ * @return false If the value is invalid.
+ */
+bool ptScheduler:: setTriggerCount (uint8_t count) {
+  if (count == 0) {
+    inputError = true;
+    return false;
+  }
+
+  prepareModeState (PT_MODE_TRIGGERED);
+  triggerState.triggersRequired = count;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the minimum time between two runs of a TRIGGERED task.
+ * 
+ * @param value Time in microseconds. 0 to run on every trigger.
+ */
+void ptScheduler:: setHoldoffTime (time_us_t value) {
+  prepareModeState (PT_MODE_TRIGGERED);
+  triggerState.holdoffTime = value;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the time a TRIGGERED task waits for the triggers to settle
+ * before running.
+ * 
+ * @param value Time in microseconds. 0 to run without waiting.
+ */
+void ptScheduler:: setDebounceTime (time_us_t value) {
+  prepareModeState (PT_MODE_TRIGGERED);
+  triggerState.debounceTime = value;
+}
+
+//==============================================================================//
+/**
+ * @brief Implements the logic of CALENDAR tasks. A calendar task runs at fixed
+ * wall clock times, such as every day at 02:00 or on every quarter hour (see
+ * ptSchedule::setCalendar()). The time is read from the clock source set with
+ * setClockSource(), like an RTC or the system clock. Only the next fire time is
+ * saved, and it is calculated directly from the clock; there is no polling of
+ * every minute in between.
+ * 
+ * Changes of the clock are handled as follows. If the clock jumps forward over
+ * one or more fire times (or the task was not called for a long time), the task
+ * runs once and continues from the new time. If the clock is set back, the next
+ * fire time is calculated again, from the new time or from just after the last
+ * fire time that ran, whichever is later. So the fire times that have already
+ * run are not repeated, even if the clock is set back over several of them.
+ * 
+ * The skip values do not apply to calendar tasks.
+ * 
+ * @return true Task to be executed.
+ * @return false Task not to be executed.
+ */
+bool ptScheduler:: calendar() {
+  prepareModeState (PT_MODE_CALENDAR);
+
+  if ((!taskEnabled) || (calendarState.clockSource == nullptr) || (schedule->getCalendarPeriod() == 0)) {
+    return false;
+  }
+
+  time_s_t now = calendarState.clockSource();
+
+  // Find the next fire time on the first call, or if the clock has been set back.
+  if (!cycleStarted) {
+    calendarState.nextFireTime = schedule->getNextFire (now);
+    taskStarted = true;
+    cycleStarted = true;
+  }
+  else if (now < calendarState.clockTime) {
+    // The fire times up to the last one have already run, even if the clock is now before them.
+    time_s_t from = (now > calendarState.lastFireTime) ? now : (calendarState.lastFireTime + 1);
+    calendarState.nextFireTime = schedule->getNextFire (from);
+  }
+
+  calendarState.clockTime = now;
+
+  if (now < calendarState.nextFireTime) {
+    return false;
+  }
+
+  // The fire time has been reached. Even if more than one fire time has passed, we run only once.
+  calendarState.lastFireTime = calendarState.nextFireTime;
+  calendarState.nextFireTime = schedule->getNextFire (now + 1);
+  intervalCounter++;
+
+  // Suspended tasks skip the fire times, but keep counting them.
+  if (taskSuspended) {
+    suspendedIntervalCounter++;
+    return false;
+  }
+
+  // Check if this is a finite repetition task.
+  if ((schedule->sequenceRepetition > 0) && (executionCounter >= schedule->sequenceRepetition)) {
+    if (schedule->sleepMode == PT_SLEEP_DISABLE) {
+      disable();
+    }
+    else {
+      suspend();
+    }
+    sequenceRepetitionEnded = true;
+    return false;
+  }
+
+  executionCounter++;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets when a CALENDAR task runs. See ptSchedule::setCalendar().
+ * inputError is set to true in case of input error.
+ * 
+ * @param offset Offset of the fire times from the Unix epoch, in seconds.
+ * @param days Days of the week to run on. A combination of PT_DAY_* values.
+ * @return true If the values are set.
+ * @return false If the values are invalid.
+ */
+bool ptScheduler:: setCalendar (time_s_t offset, uint8_t days) {
+  detachSchedule();
+
+  if (schedule->setCalendar (offset, days)) {
+    cycleStarted = false; // Find the next fire time again
+    return true;
+  }
+
+  inputError = true;
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the function that returns the wall clock time for CALENDAR tasks.
+ * The function must return the time in seconds since the Unix epoch, for example
+ * from an RTC or from time(). Calendar tasks do not run without a clock source.
+ * 
+ * @param source The clock source function. nullptr to stop the task from running.
+ */
+void ptScheduler:: setClockSource (ptClockSource source) {
+  prepareModeState (PT_MODE_CALENDAR);
+  calendarState.clockSource = source;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the time left until the task needs to be called again, based
+ * on its current state. This is the end of the ongoing interval or skip
+ * duration, the timeout or debounce time of a TRIGGERED task, or the next fire
+ * time of a CALENDAR task. If the loop sleeps, it can sleep this long without
+ * delaying the task. This function has no side effects.
+ * 
+ * @return time_us_t Time in microseconds. 0 if the task should be called now.
+ * PT_TIME_NEVER if the task does not run on its own, like disabled tasks, RATELIMIT
+ * tasks and TRIGGERED tasks waiting for a trigger without an interval.
+ */
+time_us_t ptScheduler:: getTimeToNextRun() {
+  if ((!taskEnabled) || (schedule->sequenceLength == 0)) {
+    return PT_TIME_NEVER;
+  }
+
+  uint32_t now = GET_MICROS();
+  time_us_t remaining = PT_TIME_NEVER;
+
+  switch (schedule->taskMode) {
+    case PT_MODE_ONESHOT:
+    case PT_MODE_SPANNING: {
+      bool skipSet = schedule->skipIntervalSet || schedule->skipSequenceSet || schedule->skipTimeSet;
+
+      // The task has to be called to start the skip duration or a new interval cycle.
+      if (((!taskStarted) && skipSet && (entryTime == 0)) || (taskStarted && (!cycleStarted))) {
+        return 0;
+      }
+
+      if ((!taskStarted) && skipSet) {
+        time_us_t skipElapsed = uint32_t (now - entryTime);
+        return (skipElapsed < schedule->skipTime) ? (schedule->skipTime - skipElapsed) : 0;
+      }
+
+      if (!cycleStarted) {
+        return 0;
+      }
+
+      // Same as getTimeElapsed(), without saving the result.
+      time_us_t elapsed = elapsedTime + uint32_t (uint32_t (now - entryTime) - prevTimeDelta);
+      time_us_t interval = schedule->sequenceList [sequenceIndex] * getIntervalScale();
+      remaining = (elapsed < interval) ? (interval - elapsed) : 0;
+      break;
+    }
+
+    case PT_MODE_TRIGGERED: {
+      if ((!cycleStarted) || (stateMode != PT_MODE_TRIGGERED)) {
+        return 0;
+      }
+
+      if (taskStarted) {  // Waiting for the skip time after a trigger
+        time_us_t skipElapsed = uint32_t (now - entryTime);
+        return (skipElapsed < schedule->skipTime) ? (schedule->skipTime - skipElapsed) : 0;
+      }
+
+      uint8_t currentCount = __atomic_load_n (&triggerState.triggerCount, __ATOMIC_RELAXED);
+      uint32_t timeSinceRun = now - triggerState.runTime;
+
+      if (uint8_t (currentCount - triggerState.triggerCountSeen) >= triggerState.triggersRequired) {
+        // A new trigger restarts the debounce time when the task is called.
+        uint32_t timeSinceEvent = (currentCount != triggerState.triggerCountLast) ? 0 : (now - triggerState.eventTime);
+        remaining = (timeSinceEvent < triggerState.debounceTime) ? (triggerState.debounceTime - timeSinceEvent) : 0;
+      }
+
+      if (schedule->sequenceList [0] > 0) {
+        time_us_t timeout = (timeSinceRun < schedule->sequenceList [0]) ? (schedule->sequenceList [0] - timeSinceRun) : 0;
+        remaining = (timeout < remaining) ? timeout : remaining;
+      }
+
+      if ((remaining != PT_TIME_NEVER) && (timeSinceRun < triggerState.holdoffTime) && (remaining < (triggerState.holdoffTime - timeSinceRun))) {
+        remaining = triggerState.holdoffTime - timeSinceRun;
+      }
+      break;
+    }
+
+    case PT_MODE_CALENDAR: {
+      if (stateMode != PT_MODE_CALENDAR) {  // The task has to be called to set up its state
+        return 0;
+      }
+
+      if ((calendarState.clockSource == nullptr) || (schedule->getCalendarPeriod() == 0)) {
+        return PT_TIME_NEVER;
+      }
+
+      if (!cycleStarted) {
+        return 0;
+      }
+
+      time_s_t clock = calendarState.clockSource();
+      remaining = (clock < calendarState.nextFireTime) ? ((calendarState.nextFireTime - clock) * PT_TIME_1S) : 0;
+      break;
+    }
+
+    default:  // RATELIMIT tasks run when you ask for a permit
+      break;
+  }
+
+  return remaining;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets how late the task is allowed to run. A ptCoalescer uses this to
+ * run tasks whose deadlines are close together in a single wakeup, instead of
+ * waking up for each of them. ONESHOT and SPANNING tasks start their next
+ * interval at the time the previous one ended, not when they find it ended, so
+ * the added latency does not delay the following intervals.
+ * 
+ * @param value Time in microseconds. 0 to always wake up at the deadline.
+ */
+void ptScheduler:: setSlackTime (time_us_t value) {
+  if ((value == 0) && (profile == nullptr)) {
+    return; // The slack time is 0 without a profile
+  }
+
+  getProfile()->slackTime = value;
+}
+
+//==============================================================================//
+/**
+ * @brief Saves how late the task found the end of an interval, compared to the
+ * exact deadline. This is the latency added by the loop, or by a ptCoalescer.
+ * 
+ * @param lateness Time in microseconds.
+ */
+void ptScheduler:: recordLateness (time_us_t lateness) {
+  if (profile == nullptr) {
+    return;
+  }
+
+  profile->latenessTime += lateness;
+  profile->latenessCount++;
+
+  if (lateness > profile->maxLateness) {
+    profile->maxLateness = lateness;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Prints the state variables and counters of the task.
+ * Unfortunately, print() does not accept 64-bit values.
+ * So values like timespans will be truncated to 32-bit.
+ * 
+ */
+void ptScheduler:: printStats() {
+  debugSerial.print (F("Interval Sequence Length: "));
+  debugSerial.println (schedule->sequenceLength);
+  debugSerial.print (F("Intervals (us): "));
+
+  for (int i = 0; i < schedule->sequenceLength; i++) {
+    debugSerial.print ((int32_t) schedule->sequenceList [i]);
+
+    if (i != (schedule->sequenceLength - 1)) {
+      debugSerial.print (F(", "));
+    }
+    else {
+      debugSerial.println();
+    }
+  }
+    
+  debugSerial.print (F ("Task Mode: "));
+  debugSerial.println (schedule->taskMode);
+  debugSerial.print (F ("Sleep Mode: "));
+  debugSerial.println (schedule->sleepMode);
+  debugSerial.print (F ("Skip Interval: "));
+  debugSerial.println (schedule->skipInterval);
+  debugSerial.print (F ("Skip Sequence: "));
+  debugSerial.println (schedule->skipSequence);
+  debugSerial.print (F ("Skip Time: "));
+  debugSerial.println ((int32_t) schedule->skipTime);
+  debugSerial.print (F ("sequenceRepetition: "));
+  debugSerial.println (schedule->sequenceRepetition);
+  debugSerial.print (F ("Entry Time: "));
+  debugSerial.println ((int32_t) entryTime);
+  debugSerial.print (F ("Elapsed Time: "));
+  debugSerial.println ((int32_t) elapsedTime);
+  debugSerial.print (F ("Last Elapsed Time: "));
+  debugSerial.println ((int32_t) ((profile != nullptr) ? profile->lastElapsedTime : 0));
+  debugSerial.print (F ("Exit Time: "));
+  debugSerial.println ((int32_t) ((profile != nullptr) ? profile->exitTime : 0));
+  debugSerial.print (F ("Interval Counter: "));
+  debugSerial.println ((uint32_t) intervalCounter);
+  debugSerial.print (F ("Sleep Interval Counter: "));
+  debugSerial.println ((uint32_t) suspendedIntervalCounter);
+  debugSerial.print (F ("Execution Counter: "));
+  debugSerial.println ((uint32_t) executionCounter);
+  debugSerial.print (F ("sequenceRepetition Counter: "));
+  debugSerial.println ((uint32_t) sequenceRepetitionCounter);
+  debugSerial.print (F ("Task Enabled?: "));
+  debugSerial.println (taskEnabled);
+  debugSerial.print (F ("Task Suspended?: "));
+  debugSerial.println (taskSuspended);
+  debugSerial.print (F ("Task Started?: "));
+  debugSerial.println (taskStarted);
+  debugSerial.print (F ("Cycle Started?: "));
+  debugSerial.println (cycleStarted);
+  debugSerial.print (F ("Task Running?: "));
+  debugSerial.println (taskRunning);
+  debugSerial.print (F ("Task Ended?: "));
+  debugSerial.println (sequenceRepetitionEnded);
+  debugSerial.print (F ("Task Run State: "));
+  debugSerial.println (taskRunState);
+  if (stateMode == PT_MODE_RATELIMIT) {
+    debugSerial.print (F ("Permits Per Interval: "));
+    debugSerial.println (rateLimitState.permitsPerInterval);
+    debugSerial.print (F ("Burst Capacity: "));
+    debugSerial.println (rateLimitState.burstCapacity);
+    debugSerial.print (F ("Permits Granted: "));
+    debugSerial.println ((uint32_t) rateLimitState.permitsGranted);
+    debugSerial.print (F ("Permits Denied: "));
+    debugSerial.println ((uint32_t) rateLimitState.permitsDenied);
+  }
+  if (stateMode == PT_MODE_CALENDAR) {
+    debugSerial.print (F ("Calendar Offset (s): "));
+    debugSerial.println ((uint32_t) schedule->calendarOffset);
+    debugSerial.print (F ("Calendar Days: "));
+    debugSerial.println (schedule->calendarDays, HEX);
+    debugSerial.print (F ("Next Fire Time (s): "));
+    debugSerial.println ((uint32_t) calendarState.nextFireTime);
+  }
+  debugSerial.print (F ("Input Error: "));
+  debugSerial.println (inputError);
+  debugSerial.println();
+}
+
+//==============================================================================//
+/**
+ * @brief Activates or enables a task. Only active tasks are executed
+ * regardless of their turn for execution.
+ * 
+ */
+void ptScheduler:: enable() {
+  if ((profile != nullptr) && (profile->trace != nullptr) && (!taskEnabled)) {
+    profile->trace->record (profile->taskId, PT_TRACE_ENABLE, GET_MICROS());
+  }
+  taskEnabled = true;
+  updateCyclic();
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the task enable state.
+ * 
+ * @return true Task is enabled.
+ * @return false Task is disabled.
+ */
+bool ptScheduler:: isEnabled() {
+  return taskEnabled;
+}
+
+//==============================================================================//
+/**
+ * @brief Suspends a task. The task will not be executed until it is resumed.
+ * suspendedIntervalCounter will continue to increment in this mode, which you can
+ * monitor to determine how long the task has been suspended and resume the task
+ * if necessary.
+ * 
+ */
+void ptScheduler:: suspend() {
+  if ((profile != nullptr) && (profile->trace != nullptr) && (!taskSuspended)) {
+    profile->trace->record (profile->taskId, PT_TRACE_SUSPEND, GET_MICROS());
+  }
+  taskSuspended = true;
+  updateCyclic();
+
+  // If the execution counter is reset to 0 when suspending a task,
+  // the task will start a fresh interval cycle when resumed.
+  if (toClearExecutionCounter) {
+    executionCounter = 0;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the suspended state of the task.
+ * 
+ * @return true Task is suspended.
+ * @return false Task is not suspended.
+ */
+bool ptScheduler:: isSuspended() {
+  return taskSuspended;
+}
+
+//==============================================================================//
+/**
+ * @brief Resumes a task from suspended state. The task will resume from where it
+ * was suspended.
+ * 
+ */
+void ptScheduler:: resume() {
+  if ((profile != nullptr) && (profile->trace != nullptr) && taskSuspended) {
+    profile->trace->record (profile->taskId, PT_TRACE_RESUME, GET_MICROS());
+  }
+  taskSuspended = false;
+  updateCyclic();
+  // intervalCounter = 0;
+}
+
+//==============================================================================//
+/**
+ * @brief Disables a task. This will reset all values to their default states.
+ * All user specified values will be preserved, which includes the mode, skip
+ * interval, time, sequenceRepetition, default interval, etc. You have to call
+ * either enable() or reset() functions to enable the task.
+ * 
+ */
+void ptScheduler:: disable() {
+  if ((profile != nullptr) && (profile->trace != nullptr) && taskEnabled) {
+    profile->trace->record (profile->taskId, PT_TRACE_DISABLE, GET_MICROS());
+  }
+  taskEnabled = false;
+  taskStarted = false;
+  cycleStarted = false;
+  taskSuspended = false;
+  updateCyclic();
+  sequenceRepetitionEnded = true;
+  taskRunning = false;
+  taskRunState = false;
+
+  entryTime = 0;
+  elapsedTime = 0;
+  timeDelta = 0;
+  prevTimeDelta = 0;
+  intervalCounter = 0;
+  suspendedIntervalCounter = 0;
+  executionCounter = 0;
+  sequenceRepetitionCounter = 0;
+  sequenceIndex = 0;
+
+  if (stateMode == PT_MODE_RATELIMIT) {
+    rateLimitState.permitCredit = 0;
+    rateLimitState.permitsGranted = 0;
+    rateLimitState.permitsDenied = 0;
+  }
+  else if (stateMode == PT_MODE_TRIGGERED) {
+    triggerState.triggerCountSeen = __atomic_load_n (&triggerState.triggerCount, __ATOMIC_RELAXED);  // Drop any pending triggers
+    triggerState.timedOut = false;
+  }
+
+  if (profile != nullptr) {
+    profile->exitTime = 0;
+    profile->lastElapsedTime = 0;
+    profile->latenessTime = 0;
+    profile->maxLateness = 0;
+    profile->latenessCount = 0;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief A reset reinitializes the task.
+ * 
+ */
+void ptScheduler:: reset() {
+  disable();
+  enable();
+}
+
+//==============================================================================//
+/**
+ * @brief Let's you specify the number of times the interval sequence has to be
+ * executed. See ptSchedule::setSequenceRepetition().
+ * 
+ * @param value The number of sequences to execute.
+ * @return true If the task in a valid mode and the repetition is set.
+ * @return false If operation failed.
+ */
+bool ptScheduler:: setSequenceRepetition (int32_t value) {
+  detachSchedule();
+
+  if (schedule->setSequenceRepetition (value)) {
+    return true;
+  }
+
+  inputError = true;
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Set the first interval value of an interval sequence.
+ * 
+ * @param value Time in microseconds.
+ * @return true If the value is set.
+ * @return false If the interval sequence is empty.
+ */
+bool ptScheduler:: setInterval (time_us_t value) {
+  detachSchedule();
+
+  if (schedule->setInterval (value)) {
+    return true;
+  }
+
+  inputError = true;
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Let's you set the skip duration in terms of number of intervals to skip.
+ * See ptSchedule::setSkipInterval().
+ * 
+ * @param value The number of intervals to skip.
+ * @return true If the operation is successful.
+ * @return false If the sequence is empty.
+ */
+bool ptScheduler:: setSkipInterval (uint32_t value) {
+  detachSchedule();
+  return schedule->setSkipInterval (value);
+}
+
+//==============================================================================//
+/**
+ * @brief Let's you specify the skip duration in terms of number of sequences
+ * to skip. See ptSchedule::setSkipSequence().
+ * 
+ * @param value The number of sequences to skip.
+ * @return true If the operation is successful.
+ * @return false If the sequence is empty.
+ */
+bool ptScheduler:: setSkipSequence (uint32_t value) {
+  detachSchedule();
+  return schedule->setSkipSequence (value);
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the skip duration in terms of time in microseconds.
+ * 
+ * @param value Time in microseconds.
+ * @return true If the operation is successful.
+ * @return false If the sequence is empty.
+ */
+bool ptScheduler:: setSkipTime (time_us_t value) {
+  detachSchedule();
+  return schedule->setSkipTime (value);
+}
+
+//==============================================================================//
+/**
+ * @brief Checks if there was any input error. Calling this function will
+ * also reset the flag.
+ * 
+ * @return true If there was an input error.
+ * @return false If there was no input error.
+ */
+bool ptScheduler:: isInputError() {
+  if (inputError) {
+    inputError = false;
+    return true;
+  }
+  return false;
+}
+
+//==============================================================================//
+/**
+ * @brief Starts recording the events of the task to a trace buffer. Many tasks
+ * can share the same buffer; they are told apart by their IDs.
+ * 
+ * @param buffer The trace buffer. nullptr to stop recording.
+ * @param id ID of the task in the trace.
+ */
+void ptScheduler:: setTrace (ptTrace* buffer, uint16_t id) {
+  if ((buffer == nullptr) && (profile == nullptr)) {
+    return; // Nothing is recorded yet
+  }
+
+  getProfile()->trace = buffer;
+  profile->taskId = id;
+}
+
+//==============================================================================//
+/**
+ * @brief Sets the functions to call when the output of the task changes. The
+ * rising callback is called when call() starts returning true, and the falling
+ * callback when it starts returning false. Each is called exactly once per
+ * change, from inside call() or edge(). The task is passed to the callback, so
+ * the same callback can be used for many tasks.
+ * 
+ * @param rising Function to call on a rising edge. nullptr for none.
+ * @param falling Function to call on a falling edge. nullptr for none.
+ */
+void ptScheduler:: setEdgeCallbacks (ptEdgeCallback rising, ptEdgeCallback falling) {
+  if ((rising == nullptr) && (falling == nullptr) && (profile == nullptr)) {
+    return; // Nothing to clear
+  }
+
+  getProfile()->risingCallback = rising;
+  profile->fallingCallback = falling;
+}
+
+//==============================================================================//
+/**
+ * @brief Marks the end of the work done by the task after it returned true.
+ * The time since the task returned true is saved as the run duration, added to
+ * the busy time of the task and recorded to the trace. Call this at the end of
+ * the code block enclosed by call().
+ * 
+ */
+void ptScheduler:: complete() {
+  uint32_t time = GET_MICROS();
+  ptTaskProfile* runProfile = getProfile();
+  runProfile->lastRunTime = time - runStartTime;
+  runProfile->busyTime += runProfile->lastRunTime;
+
+  if (runProfile->trace != nullptr) {
+    runProfile->trace->record (runProfile->taskId, PT_TRACE_COMPLETE, time, runProfile->lastRunTime);
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Calculates the checksum of a snapshot. The checksum field itself is
+ * not included.
+ * 
+ * @param state The snapshot.
+ * @return uint8_t The 8-bit sum of all bytes.
+ */
+static uint8_t getSnapshotChecksum (const ptSnapshot& state) {
+  const uint8_t* bytes = (const uint8_t*) &state;
+  uint8_t sum = 0;
+
+  for (size_t i = 0; i < sizeof (ptSnapshot); i++) {
+    if (bytes + i != &state.checksum) {
+      sum += bytes [i];
+    }
+  }
+  return sum;
+}
+
+//==============================================================================//
+/**
+ * @brief Saves the runtime state of the task (counters, flags, the phase of
+ * the ongoing interval and the permits of a RATELIMIT task) to a snapshot. Times are saved relative to the entry
+ * time, so that they can be restored against a different clock.
+ * 
+ * @param state The snapshot to write to.
+ */
+void ptScheduler:: snapshot (ptSnapshot& state) {
+  memset (&state, 0, sizeof (ptSnapshot));
+
+  state.magic = PT_SNAPSHOT_MAGIC;
+  state.version = PT_SNAPSHOT_VERSION;
+  state.taskMode = schedule->taskMode;
+  state.sequenceLength = schedule->sequenceLength;
+  state.sequenceIndex = sequenceIndex;
+
+  state.flags = (taskEnabled ? PT_SNAPSHOT_ENABLED : 0) |
+                (taskStarted ? PT_SNAPSHOT_STARTED : 0) |
+                (cycleStarted ? PT_SNAPSHOT_CYCLE : 0) |
+                (taskSuspended ? PT_SNAPSHOT_SUSPENDED : 0) |
+                (sequenceRepetitionEnded ? PT_SNAPSHOT_ENDED : 0) |
+                (taskRunning ? PT_SNAPSHOT_RUNNING : 0) |
+                (taskRunState ? PT_SNAPSHOT_RUN_STATE : 0);
+
+  // Save how far the task has progressed in the ongoing interval or skip duration.
+  if (taskEnabled && cycleStarted) {
+    getTimeElapsed();
+    state.elapsedTime = elapsedTime;
+  }
+  else if (taskEnabled && (!taskStarted) && (entryTime != 0)) {
+    state.flags |= PT_SNAPSHOT_SKIPPING;
+    state.elapsedTime = uint32_t (GET_MICROS() - entryTime);
+  }
+  else if (taskEnabled && taskStarted && (schedule->taskMode == PT_MODE_RATELIMIT)) {
+    state.elapsedTime = getLongMicrosSince (getLongMicros(), entryTime);  // Time since the permits were last added
+  }
+
+  state.intervalCounter = intervalCounter;
+  state.suspendedIntervalCounter = suspendedIntervalCounter;
+  state.executionCounter = executionCounter;
+  state.sequenceRepetitionCounter = sequenceRepetitionCounter;
+
+  if (stateMode == PT_MODE_RATELIMIT) {
+    state.permitCredit = rateLimitState.permitCredit;
+    state.permitsGranted = rateLimitState.permitsGranted;
+    state.permitsDenied = rateLimitState.permitsDenied;
+  }
 
-        if (elapsedTime < skipTime) { // skipTime is set when skip time or skip interval is set
-          return false;
+  state.checksum = getSnapshotChecksum (state);
+}
+
+//==============================================================================//
+/**
+ * @brief Restores the runtime state of the task from a snapshot. The entry time
+ * is re-based against the current clock so that the task resumes in the same
+ * phase it was saved in. If the clock was not running for some time, for example
+ * during deep sleep, pass that duration as the time offset. The task is then
+ * advanced as if it had been running all along. If any intervals ended during
+ * that time, ONESHOT and SPANNING tasks are advanced from the saved counters
+ * with resync(), so the counters include the runs (or the suspended intervals)
+ * that were missed, and the task continues in phase. Stretched intervals
+ * (see setIntervalScale()) are taken into account.
+ * 
+ * The snapshot is rejected if it is corrupted, of a different version, or was
+ * saved from a task with a different mode or sequence length. inputError is set
+ * in that case.
+ * 
+ * @param state The snapshot to restore from.
+ * @param timeOffset Time in microseconds that has passed without the clock running.
+ * @return true If the state was restored.
+ * @return false If the snapshot is invalid.
+ */
+bool ptScheduler:: restore (const ptSnapshot& state, time_us_t timeOffset) {
+  if ((state.magic != PT_SNAPSHOT_MAGIC) || (state.version != PT_SNAPSHOT_VERSION) ||
+      (state.checksum != getSnapshotChecksum (state)) || (state.taskMode != schedule->taskMode) ||
+      (state.sequenceLength != schedule->sequenceLength) || (state.sequenceIndex >= schedule->sequenceLength)) {
+    inputError = true;
+    return false;
+  }
+
+  prepareModeState (schedule->taskMode);
+  disable();  // Start from a known state
+
+  taskEnabled = (state.flags & PT_SNAPSHOT_ENABLED) != 0;
+  taskStarted = (state.flags & PT_SNAPSHOT_STARTED) != 0;
+  cycleStarted = (state.flags & PT_SNAPSHOT_CYCLE) != 0;
+  taskSuspended = (state.flags & PT_SNAPSHOT_SUSPENDED) != 0;
+  updateCyclic();
+  sequenceRepetitionEnded = (state.flags & PT_SNAPSHOT_ENDED) != 0;
+  taskRunning = (state.flags & PT_SNAPSHOT_RUNNING) != 0;
+  taskRunState = (state.flags & PT_SNAPSHOT_RUN_STATE) != 0;
+  sequenceIndex = state.sequenceIndex;
+
+  intervalCounter = state.intervalCounter;
+  suspendedIntervalCounter = state.suspendedIntervalCounter;
+  executionCounter = state.executionCounter;
+  sequenceRepetitionCounter = state.sequenceRepetitionCounter;
+
+  if (stateMode == PT_MODE_RATELIMIT) {
+    rateLimitState.permitCredit = state.permitCredit;
+    rateLimitState.permitsGranted = state.permitsGranted;
+    rateLimitState.permitsDenied = state.permitsDenied;
+  }
+
+  // Rate limit tasks earn permits for the time since the last call, including the time offset.
+  if (taskEnabled && taskStarted && (schedule->taskMode == PT_MODE_RATELIMIT)) {
+    refillPermits (state.elapsedTime + timeOffset);
+    entryTime = getLongMicros();
+    return true;
+  }
+
+  // Calendar tasks follow the wall clock, so they find their next fire time again.
+  if (schedule->taskMode == PT_MODE_CALENDAR) {
+    cycleStarted = false;
+  }
+
+  time_us_t elapsed = state.elapsedTime + timeOffset;
+
+  // If the task would have moved past the ongoing interval (or the skip duration) while the clock
+  // was not running, advance it from the saved state by the intervals that ended in that time,
+  // as resync() does. The runs that fell in that time are counted, but not returned.
+  if (taskEnabled && (timeOffset > 0) &&
+      ((schedule->taskMode == PT_MODE_ONESHOT) || (schedule->taskMode == PT_MODE_SPANNING))) {
+    if ((state.flags & PT_SNAPSHOT_SKIPPING) && (elapsed >= schedule->skipTime)) {
+      taskStarted = true; // The skip duration has ended; the first interval started right then
+      elapsed -= schedule->skipTime;
+    }
+    else if (taskStarted && (!cycleStarted)) {  // A ONESHOT interval has ended, but the next one has not started yet
+      elapsed = timeOffset;
+    }
+
+    if (taskStarted || cycleStarted) {
+      if (!cycleStarted) {  // Start the interval the same way the task does
+        if (schedule->taskMode == PT_MODE_ONESHOT) {
+          oneshot();
         }
         else {
-          taskStarted = true;
-          taskRunState = true;
+          spanning();
         }
       }
+
+      if (taskEnabled) {  // The task may have completed its repetitions when starting
+        rebaseTime (elapsed);
+        resync (getElapsedIntervals());
+      }
+
+      return true;
     }
+  }
 
-    // If an interval cycle has not started yet, then initialize all variables with
-    // a known default state. We also save the entry time at this time.
-    // For spanning tasks, this only happens once.
-    if (!cycleStarted) {
-      taskRunState = true;
-      taskRunning = true;
-      executionCounter++; // This increments before the interval counter
-      elapsedTime = 0;  // Reset so that we can start a new cycle
-      prevTimeDelta = 0;
-      entryTime = GET_MICROS(); // Get the entry time
-      cycleStarted = true;
-      sequenceRepetitionEnded = false;
-      taskStarted = true;
-      sequenceIndex = 0;
-      intervalCounter = 0;
-      // printStats();
+  // Move the entry time back so that the elapsed time continues from where it was saved.
+  if (taskEnabled && (cycleStarted || (state.flags & PT_SNAPSHOT_SKIPPING))) {
+    rebaseTime (elapsed);
+  }
+
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Marks the task as low priority. Low priority tasks can be slowed down
+ * or suspended by a ptMonitor when the loop is overloaded.
+ * 
+ * @param value true for low priority.
+ */
+void ptScheduler:: setLowPriority (bool value) {
+  if ((!value) && (profile == nullptr)) {
+    return; // Tasks are not low priority by default
+  }
+
+  getProfile()->lowPriority = value;
+}
+
+//==============================================================================//
+/**
+ * @brief Stretches all intervals of a ONESHOT or SPANNING task by a factor.
+ * ptMonitor uses this to slow down low priority tasks, but you can also set it
+ * yourself. The other modes ignore it.
+ * 
+ * @param value The factor; 1 for the intervals as they are.
+ * @return true If the value is valid.
+ * @return false If the value is 0.
+ */
+bool ptScheduler:: setIntervalScale (uint8_t value) {
+  if (value == 0) {
+    inputError = true;
+    return false;
+  }
+
+  if ((value == 1) && (profile == nullptr)) {
+    return true;  // Intervals are not stretched by default
+  }
+
+  getProfile()->intervalScale = value;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the factor all intervals are stretched by. See setIntervalScale().
+ * 
+ * @return uint8_t The factor; 1 if the intervals are not stretched.
+ */
+uint8_t ptScheduler:: getIntervalScale() const {
+  return (profile != nullptr) ? profile->intervalScale : 1;
+}
+
+//==============================================================================//
+/**
+ * @brief Validates a binary schedule image and prepares it for use. The image
+ * is not copied; the task records and the interval table are used in place.
+ * This means the memory must remain valid as long as any task uses it. On a
+ * host system, you can simply mmap() the schedule file and pass the pointer here.
+ * If you want to change the intervals of the tasks later, map the file as
+ * private and writable.
+ * 
+ * @param image Pointer to the start of the image. Must be 8-byte aligned.
+ * @param imageSize Size of the image in bytes.
+ * @return true If the image is valid.
+ * @return false If the image is malformed or of a different version.
+ */
+bool ptScheduleImage:: begin (const void* image, size_t imageSize) {
+  header = nullptr;
+  records = nullptr;
+  intervals = nullptr;
+  sums = nullptr;
+
+  if ((image == nullptr) || (imageSize < sizeof (ptImageHeader))) {
+    return false;
+  }
+
+  // The interval table is used in place, so it must be properly aligned.
+  if ((uintptr_t (image) % sizeof (time_us_t)) != 0) {
+    return false;
+  }
+
+  const ptImageHeader* imageHeader = (const ptImageHeader*) image;
+
+  if ((imageHeader->magic != PT_IMAGE_MAGIC) || (imageHeader->version != PT_IMAGE_VERSION) ||
+      (imageHeader->recordSize != sizeof (ptImageRecord))) {
+    return false;
+  }
+
+  if (imageSize < getImageSize (imageHeader->taskCount, imageHeader->intervalCount)) {
+    return false;
+  }
+
+  header = imageHeader;
+  records = (const ptImageRecord*) ((const uint8_t*) image + sizeof (ptImageHeader));
+  intervals = (const time_us_t*) (records + imageHeader->taskCount);
+  sums = intervals + imageHeader->intervalCount;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the number of tasks defined in the image.
+ * 
+ * @return uint32_t Number of task records. 0 if no valid image is loaded.
+ */
+uint32_t ptScheduleImage:: getTaskCount() {
+  if (header == nullptr) {
+    return 0;
+  }
+  return header->taskCount;
+}
+
+//==============================================================================//
+/**
+ * @brief Loads a schedule from a record in the image. The interval sequence and
+ * the prefix sums of the schedule will point directly into the image. Anything
+ * the schedule allocated before is freed. inputError of the schedule is set if
+ * the record contains invalid modes.
+ * 
+ * @param schedule The schedule to load to.
+ * @param index Index of the task record in the image.
+ * @return true If the schedule was loaded.
+ * @return false If the index or the record is invalid.
+ */
+bool ptScheduleImage:: load (ptSchedule& schedule, uint32_t index) {
+  if ((header == nullptr) || (index >= header->taskCount)) {
+    return false;
+  }
+
+  const ptImageRecord& record = records [index];
+
+  // Check if the interval sequence lies inside the interval table.
+  if ((record.sequenceLength == 0) || (record.intervalOffset > header->intervalCount) ||
+      (record.sequenceLength > (header->intervalCount - record.intervalOffset))) {
+    return false;
+  }
+
+  schedule = ptSchedule();  // Free what the schedule owned before, and start from the defaults
+  schedule.sequenceList = (time_us_t*) (intervals + record.intervalOffset);
+  schedule.sequenceLength = record.sequenceLength;
+  schedule.sequenceSums = (time_us_t*) (sums + record.intervalOffset);
+  schedule.sequenceSumsLength = 0;  // The prefix sums are not owned by the schedule
+  schedule.sequenceListOwned = false; // Neither are the intervals
+  schedule.sequencePeriod = schedule.sequenceSums [record.sequenceLength - 1];
+  schedule.inputError = false;
+  schedule.setTaskMode (record.taskMode);
+  schedule.setSleepMode (record.sleepMode);
+  schedule.setSequenceRepetition (record.sequenceRepetition);
+
+  // The skip duration is already calculated, so we don't have to do it again.
+  schedule.skipInterval = record.skipInterval;
+  schedule.skipSequence = record.skipSequence;
+  schedule.skipTime = record.skipTime;
+  schedule.skipIntervalSet = (record.skipFlags & PT_IMAGE_SKIP_INTERVAL) != 0;
+  schedule.skipSequenceSet = (record.skipFlags & PT_IMAGE_SKIP_SEQUENCE) != 0;
+  schedule.skipTimeSet = (record.skipFlags & PT_IMAGE_SKIP_TIME) != 0;
+  schedule.calendarOffset = record.calendarOffset;
+  schedule.calendarDays = record.calendarDays;
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Configures a task from a record in the image. The record is loaded to
+ * the given schedule with load(), and the task is set to use it. All runtime
+ * states of the task are reset and the task is enabled. inputError of the task
+ * is set if the record contains invalid modes.
+ * 
+ * @param task The task to configure.
+ * @param schedule The schedule to load the record to. Must remain valid as long as the task uses it.
+ * @param index Index of the task record in the image.
+ * @return true If the task was configured.
+ * @return false If the index or the record is invalid.
+ */
+bool ptScheduleImage:: apply (ptScheduler& task, ptSchedule& schedule, uint32_t index) {
+  if (!load (schedule, index)) {
+    return false;
+  }
+
+  task.setSchedule (schedule);
+
+  if (schedule.inputError) {
+    task.inputError = true;
+  }
+  return true;
+}
+
+//==============================================================================//
+/**
+ * @brief Configures an array of tasks from the image. Task n in the array is
+ * configured from record n in the image, using schedule n in the array of
+ * schedules. The arrays are usually created with the default constructors, for
+ * example `new ptScheduler [image.getTaskCount()]`. If many tasks in your image
+ * have the same schedule, you can instead load it once with load() and share it
+ * with setSchedule().
+ * 
+ * @param tasks Pointer to the array of tasks.
+ * @param schedules Pointer to the array of schedules, with the same number of elements.
+ * @param taskCount Number of tasks in the array.
+ * @return uint32_t The number of tasks successfully configured.
+ */
+uint32_t ptScheduleImage:: applyAll (ptScheduler* tasks, ptSchedule* schedules, uint32_t taskCount) {
+  uint32_t count = 0;
+
+  if ((tasks == nullptr) || (schedules == nullptr)) {
+    return 0;
+  }
+
+  for (uint32_t i = 0; (i < taskCount) && (i < getTaskCount()); i++) {
+    if (apply (tasks [i], schedules [i], i)) {
+      count++;
     }
-    else {  // If an interval cycle has started
-      getTimeElapsed();  // Get the elapsed time since entry time
+  }
+  return count;
+}
 
-      if (elapsedTime >= sequenceList [sequenceIndex]) { // Check if the elapsed time is greater than an interval in the sequence list.
-        if (sequenceIndex < (sequenceLength - 1)) { // Move to the next interval in the sequence list.
-          sequenceIndex++;
-        }
-        else { // Else reset to the first interval in the sequence list.
-          sequenceIndex = 0;
-        }
+//==============================================================================//
+/**
+ * @brief Returns the size of a schedule image in bytes.
+ * 
+ * @param taskCount Number of tasks in the image.
+ * @param intervalCount Total number of intervals in the image.
+ * @return size_t Size in bytes.
+ */
+size_t ptScheduleImage:: getImageSize (uint32_t taskCount, uint32_t intervalCount) {
+  return sizeof (ptImageHeader) + (size_t (taskCount) * sizeof (ptImageRecord)) +
+         (2 * size_t (intervalCount) * sizeof (time_us_t));
+}
 
-        intervalCounter++; // Counter increments after an interval (not sequence) is completed.
-        exitTime = entryTime + elapsedTime; // Save the exit time
-        lastElapsedTime = elapsedTime;
-        entryTime = GET_MICROS(); // After an interval is completed, get the new entry time.
-        elapsedTime = 0;
-        prevTimeDelta = 0;
-        timeDelta = 0;
+//==============================================================================//
+/**
+ * @brief Creates a schedule image from a list of tasks created in code. You can
+ * save the resulting buffer to a file and load it later with begin(). Only the
+ * schedule definitions are saved; not the runtime states.
+ * 
+ * @param tasks Pointer to the array of tasks.
+ * @param taskCount Number of tasks in the array.
+ * @param buffer The buffer to write the image to. Must be 8-byte aligned.
+ * @param bufferSize Size of the buffer in bytes.
+ * @return size_t Number of bytes written. 0 if the buffer is too small.
+ */
+size_t ptScheduleImage:: write (ptScheduler* tasks, uint32_t taskCount, void* buffer, size_t bufferSize) {
+  if ((tasks == nullptr) || (buffer == nullptr) || ((uintptr_t (buffer) % sizeof (time_us_t)) != 0)) {
+    return 0;
+  }
 
-        if (taskSuspended) { // If the task gets suspended.
-          // printStats();
-          suspendedIntervalCounter++; // Counts how long a task remains suspended.
-          
-          // The following line restores a suspended task to the same state during which it was suspended.
-          // Without this, the states may be swapped after resuming a task.
-          taskRunState = (taskRunState) ? false : true; // Toggle the state
-          
-          // If you return taskRunState instead, you can generate pulses on rising and falling edges.
-          // Try it out and see what happens.
-          return false;
-        }
+  uint32_t intervalCount = 0;
 
-        if (!taskSuspended) { // If the task is still active.
-          if (sequenceRepetition > 0) { // If this is a finite repetition task.
-            if (executionCounter >= sequenceRepetitionExtended) { // Check if the task has completed all its repetitions.
-              // If yes, put the task to sleep; either DISABLE or SUSPEND.
-              if (sleepMode == PT_SLEEP_DISABLE) {
-                // No counters will be running in disabled mode
-                disable();
-              }
-              else {
-                // But in suspend mode, some counters will be running
-                // which allows you to resume the task based on how long it has been suspended.
-                suspend();
-              }
-              
-              // intervalCounter = 0;
-              taskRunState = false;
-              taskRunning = false;
-              sequenceRepetitionEnded = true;
-              suspendedIntervalCounter = 0;
-              // sequenceIndex = 0;  // You have to manually reset this, if you want
-              return false;
-            }
-          }
+  for (uint32_t i = 0; i < taskCount; i++) {
+    intervalCount += tasks [i].schedule->sequenceLength;
+  }
+
+  size_t imageSize = getImageSize (taskCount, intervalCount);
+
+  if (bufferSize < imageSize) {
+    return 0;
+  }
+
+  ptImageHeader* imageHeader = (ptImageHeader*) buffer;
+  ptImageRecord* imageRecords = (ptImageRecord*) ((uint8_t*) buffer + sizeof (ptImageHeader));
+  time_us_t* imageIntervals = (time_us_t*) (imageRecords + taskCount);
+  time_us_t* imageSums = imageIntervals + intervalCount;
+
+  imageHeader->magic = PT_IMAGE_MAGIC;
+  imageHeader->version = PT_IMAGE_VERSION;
+  imageHeader->recordSize = sizeof (ptImageRecord);
+  imageHeader->taskCount = taskCount;
+  imageHeader->intervalCount = intervalCount;
+
+  uint32_t offset = 0;
+
+  for (uint32_t i = 0; i < taskCount; i++) {
+    const ptSchedule& schedule = *tasks [i].schedule;
+    ptImageRecord& record = imageRecords [i];
+
+    record.skipTime = schedule.skipTime;
+    record.intervalOffset = offset;
+    record.sequenceRepetition = schedule.sequenceRepetition;
+    record.skipInterval = schedule.skipInterval;
+    record.skipSequence = schedule.skipSequence;
+    record.sequenceLength = schedule.sequenceLength;
+    record.taskMode = schedule.taskMode;
+    record.sleepMode = schedule.sleepMode;
+    record.skipFlags = (schedule.skipIntervalSet ? PT_IMAGE_SKIP_INTERVAL : 0) |
+                       (schedule.skipSequenceSet ? PT_IMAGE_SKIP_SEQUENCE : 0) |
+                       (schedule.skipTimeSet ? PT_IMAGE_SKIP_TIME : 0);
+    record.calendarOffset = uint32_t (schedule.calendarOffset);
+    record.calendarDays = schedule.calendarDays;
+    memset (record.reserved, 0, sizeof (record.reserved));
+
+    time_us_t sum = 0;
+
+    for (uint8_t j = 0; j < schedule.sequenceLength; j++) {
+      sum += schedule.sequenceList [j];
+      imageIntervals [offset + j] = schedule.sequenceList [j];
+      imageSums [offset + j] = sum;
+    }
+    offset += schedule.sequenceLength;
+  }
+
+  return imageSize;
+}
+
+//==============================================================================//
+/**
+ * @brief Reads the head of a trace buffer. The reads of the events before this
+ * are done before the head is read, and the reads after this are done after it.
+ * 
+ * @param head The head of the trace buffer.
+ * @return uint16_t The value of the head.
+ */
+static inline uint16_t loadTraceHead (const volatile uint16_t& head) {
+#if defined (__AVR__)
+  // A 16-bit read is not atomic on AVR, so the interrupts are disabled instead.
+  __asm__ __volatile__ ("" ::: "memory");
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t value = head;
+  SREG = oldSREG;
+  __asm__ __volatile__ ("" ::: "memory");
+  return value;
+#else
+  __atomic_thread_fence (__ATOMIC_ACQUIRE);
+  return __atomic_load_n (&head, __ATOMIC_ACQUIRE);
+#endif
+}
+
+//==============================================================================//
+/**
+ * @brief Advances the head of a trace buffer. The writes of the event before
+ * this are visible to the reader before the new head is.
+ * 
+ * @param head The head of the trace buffer.
+ * @param value The new value of the head.
+ */
+static inline void storeTraceHead (volatile uint16_t& head, uint16_t value) {
+#if defined (__AVR__)
+  __asm__ __volatile__ ("" ::: "memory");
+  uint8_t oldSREG = SREG;
+  cli();
+  head = value;
+  SREG = oldSREG;
+#else
+  __atomic_store_n (&head, value, __ATOMIC_RELEASE);
+#endif
+}
+
+//==============================================================================//
+/**
+ * @brief Records an event to the trace buffer. This is called by the tasks. The
+ * event is written before the head is advanced, and the head is advanced with
+ * release ordering, so a reader that sees the new head also sees the whole event.
+ * 
+ * @param taskId ID of the task.
+ * @param type Event type. One of the PT_TRACE_* values.
+ * @param time Value of micros() at the event.
+ * @param duration Run duration in microseconds, for PT_TRACE_COMPLETE events.
+ */
+void ptTrace:: record (uint16_t taskId, uint8_t type, uint32_t time, uint32_t duration) {
+  uint16_t position = head;  // Only the writer changes the head
+  ptTraceEvent& event = events [position & (PT_TRACE_SIZE - 1)];
+
+  event.time = time;
+  event.duration = duration;
+  event.taskId = taskId;
+  event.type = type;
+  storeTraceHead (head, position + 1);
+}
+
+//==============================================================================//
+/**
+ * @brief Reads the oldest unread event from the trace buffer. If the writer has
+ * overwritten events that were not read yet, they are skipped and counted in
+ * droppedCount.
+ * 
+ * @param event The event read.
+ * @return true If an event was read.
+ * @return false If there are no unread events.
+ */
+bool ptTrace:: read (ptTraceEvent& event) {
+  while (true) {
+    uint16_t position = loadTraceHead (head);
+
+    if (position == tail) {
+      return false;
+    }
+
+    // Skip the events that have been overwritten.
+    if (uint16_t (position - tail) > PT_TRACE_SIZE) {
+      droppedCount += uint16_t (position - tail) - PT_TRACE_SIZE;
+      tail = position - PT_TRACE_SIZE;
+    }
+
+    event = events [tail & (PT_TRACE_SIZE - 1)];
+    position = loadTraceHead (head);
+
+    // The writer starts overwriting the event when the head reaches (tail + PT_TRACE_SIZE).
+    // If it got there while we were copying, the copy may be partially written, so drop it.
+    if (uint16_t (position - tail) < PT_TRACE_SIZE) {
+      tail++;
+      return true;
+    }
+
+    droppedCount++;
+    tail++;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Returns the number of unread events in the trace buffer.
+ * 
+ * @return uint16_t Number of events.
+ */
+uint16_t ptTrace:: available() {
+  uint16_t count = loadTraceHead (head) - tail;
+  return (count > PT_TRACE_SIZE) ? PT_TRACE_SIZE : count;
+}
+
+//==============================================================================//
+/**
+ * @brief Discards all events in the trace buffer.
+ * 
+ */
+void ptTrace:: clear() {
+  tail = loadTraceHead (head);
+  droppedCount = 0;
+}
+
+//==============================================================================//
+/**
+ * @brief Prints a 64-bit value in decimal, since print() does not accept
+ * 64-bit values.
+ * 
+ * @param output The output stream.
+ * @param value The value to print.
+ */
+static void printTraceTime (Print& output, uint64_t value) {
+  if (value >= 1000000000ULL) {
+    char digits [10];
+    output.print ((uint32_t) (value / 1000000000ULL));
+    snprintf (digits, sizeof (digits), "%09lu", (unsigned long) (value % 1000000000ULL));
+    output.print (digits);
+  }
+  else {
+    output.print ((uint32_t) value);
+  }
+}
 
-          // Determine the next state of the task. Since we are here because an interval has ended,
-          // we can toggle the task state.
-          taskRunState = (taskRunState) ? false : true;
+//==============================================================================//
+/**
+ * @brief Reads all unread events and prints them in the Chrome Trace Event
+ * format (JSON). Save the output to a file and open it with Perfetto
+ * (ui.perfetto.dev) or chrome://tracing to see a timeline of all tasks. Each
+ * task is shown as a thread with its ID. Run durations are shown as slices,
+ * the true state of the output as "active" slices, and the other events as
+ * instant events. The micros() values are extended to 64 bits, so keep reading
+ * the buffer at least once every 71 minutes.
+ * 
+ * Printing is slow. Do this when the timing no longer matters, such as after
+ * a test run; recording the events itself takes only a few instructions.
+ * 
+ * @param output The output stream. For example, Serial.
+ */
+void ptTrace:: printChromeTrace (Print& output) {
+  ptTraceEvent event;
+  bool first = true;
 
-          // If the task state is true, then we can also increment the execution counter.
-          // The execution counter keeps track of how many times the task has been executed (returned true).
-          if (taskRunState) {
-            executionCounter++;
-            taskRunning = true;
-            // printStats();
-          }
-          else {
-            taskRunning = false;
-          }
-        }
-      }
+  output.print (F ("{\"traceEvents\":["));
+
+  while (read (event)) {
+    // Extend the 32-bit time to 64 bits.
+    if (exportTime == 0) {
+      exportTime = event.time;
+    }
+    else {
+      exportTime += uint32_t (event.time - prevTime);
     }
+    prevTime = event.time;
 
-    // If the task is not suspended, persist the state until the interval ends.
-    if (!taskSuspended) {
-      return taskRunState;
+    if (!first) {
+      output.print (F (","));
     }
+    first = false;
 
-    // If the task is in suspended mode, always return false.
-    return false;
-  }
+    output.print (F ("\n{\"pid\":0,\"tid\":"));
+    output.print (event.taskId);
+    output.print (F (",\"ts\":"));
 
-  else { // If the task is not enabled.
-    return false;
+    switch (event.type) {
+      case PT_TRACE_COMPLETE:
+        printTraceTime (output, exportTime - event.duration);
+        output.print (F (",\"ph\":\"X\",\"name\":\"run\",\"dur\":"));
+        output.print (event.duration);
+        break;
+
+      case PT_TRACE_RISE:
+        printTraceTime (output, exportTime);
+        output.print (F (",\"ph\":\"B\",\"name\":\"active\""));
+        break;
+
+      case PT_TRACE_FALL:
+        printTraceTime (output, exportTime);
+        output.print (F (",\"ph\":\"E\",\"name\":\"active\""));
+        break;
+
+      default:
+        printTraceTime (output, exportTime);
+        output.print (F (",\"ph\":\"i\",\"s\":\"t\",\"name\":\""));
+
+        switch (event.type) {
+          case PT_TRACE_FIRE: output.print (F ("fire")); break;
+          case PT_TRACE_SUSPEND: output.print (F ("suspend")); break;
+          case PT_TRACE_RESUME: output.print (F ("resume")); break;
+          case PT_TRACE_DISABLE: output.print (F ("disable")); break;
+          case PT_TRACE_ENABLE: output.print (F ("enable")); break;
+          default: output.print (F ("unknown")); break;
+        }
+        output.print (F ("\""));
+        break;
+    }
+    output.print (F ("}"));
   }
+
+  output.println (F ("\n]}"));
 }
 
 //==============================================================================//
+// Constructors
+
 /**
- * @brief Implements the logic of ONESHOT tasks. ONESHOT returns true momentarily during the
- * rising edge of an interval.
+ * @brief Creates a monitor for a list of tasks. The monitor measures how much
+ * of the time the tasks are busy doing work, from the run durations saved by
+ * ptScheduler::complete(). The rest of the time is counted as idle.
  * 
- * @return true Task to be executed.
- * @return false Task not to be executed.
+ * @param tasks Pointer to an array of task pointers.
+ * @param count Number of tasks in the array.
+ * @param window Measurement window in microseconds. The utilization is updated once every window.
+ * @return ptMonitor:: 
  */
-bool ptScheduler:: oneshot() {
-  if (taskEnabled) {
-    // If an execution cycle has not started yet, defer the task until the time set by the
-    // user (called skip time). The user can specify the skip time in terms of time, sequence
-    // or interval.
-    if ((!taskStarted)) {
-      if (skipIntervalSet || skipSequenceSet || skipTimeSet) {
-        if (entryTime == 0) { // This is one way to find if an execution cycle has not started.
-          elapsedTime = 0;
-          entryTime = GET_MICROS(); // Get the entry time.
-          return false;
-        }
-        else { // If we have already entered the skip duration.
-          if ((GET_MICROS() - entryTime) < skipTime) {
-            return false;
-          }
-          else {
-            taskStarted = true; // Start the task after the skip duration is elapsed.
-          }
-        }
-      }
-    }
+ptMonitor:: ptMonitor (ptScheduler** tasks, uint8_t count, time_us_t window) {
+  taskList = tasks;
+  taskCount = (tasks != nullptr) ? count : 0;
+  windowTime = (window > 0) ? window : PT_TIME_DEFAULT;
+}
 
-    // Start a new interval cycle, if it has not already.
-    // We get a true signal every time an interval starts.
-    // If you don't want a oneshot task to be executed at the start of a new interval cycle,
-    // then simply set a skip time.
-    if (!cycleStarted) {
-      elapsedTime = 0;
-      prevTimeDelta = 0;
-      timeDelta = 0;
-      entryTime = GET_MICROS(); // Get the entry time.
-      cycleStarted = true;
-      // intervalCounter++;
+//==============================================================================//
+/**
+ * @brief Updates the utilization. Call this once in every loop. At the end of
+ * each measurement window, the busy time of all tasks is collected and the
+ * utilization is calculated. If the utilization reaches the overload threshold,
+ * the task set is considered overloaded and the shedding policy takes one step. If
+ * the utilization falls to the recovery threshold, one step is undone. Taking
+ * one step per window avoids switching back and forth.
+ * 
+ */
+void ptMonitor:: update() {
+  microsValue = GET_MICROS();
 
-      // If the tasks gets suspended, always return false.
-      // But also increment the suspended interval counter so that we can use it to
-      // resume the task.
-      if (taskSuspended) {
-        suspendedIntervalCounter++;
-        return false;
+  if (!monitorStarted) {
+    monitorStarted = true;
+    windowStart = microsValue;
+
+    // Discard the busy time from before the monitor started.
+    for (uint8_t i = 0; i < taskCount; i++) {
+      if (taskList [i]->profile != nullptr) {
+        taskList [i]->profile->busyTime = 0;
       }
+    }
+    return;
+  }
 
-      // This is the return point that gives you green signal each time.
-      if (!taskSuspended) {
-        // Check if this is a finite repetition task.
-        // If yes, we must either disable or suspend the task after the specified number of repetitions.
-        if (sequenceRepetition > 0) {
-          if (sequenceRepetitionCounter >= sequenceRepetition) {
-            if (sleepMode == PT_SLEEP_DISABLE) {
-              disable(); // Interval counter will not run in this mode.
-            }
-            else {
-              // This is the self-suspend mode.
-              // Interval counter runs and you can resume the task when you need.
-              suspend();
-            }
+  loopCounter++;
+  uint32_t windowElapsed = microsValue - windowStart;
 
-            // A sequence is not considered ended until all of the intervals have been elapsed.
-            // Oneshot tasks return true at the start of an interval. Therefore, execution counter
-            // being equal to sequenceRepetition does not mean the last interval is elapsed.
-            // Therefore, the last execution cycle of a oneshot sequence would not return this variable
-            // as true. It will be only true after the last interval in the sequence has elapsed.
-            sequenceRepetitionEnded = true;
+  if (windowElapsed < windowTime) {
+    return;
+  }
 
-            // The suspended interval counter is reset at this point so that any subsequent
-            // invocation of the task will increment it from 0.
-            suspendedIntervalCounter = 0;
+  time_us_t windowBusyTime = 0;
 
-            // We return false because the task is now either disabled or suspended.
-            return false;
-          }
-        }
-        executionCounter++;
-        return true;
-      }
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (taskList [i]->profile != nullptr) {
+      windowBusyTime += taskList [i]->profile->busyTime;
+      taskList [i]->profile->busyTime = 0;
     }
+  }
 
-    // If an interval cycle has already started, then we need to check if the interval has ended or not.
-    if (cycleStarted) {
-      getTimeElapsed();
+  busyTime = windowBusyTime;
+  idleTime = (windowBusyTime < windowElapsed) ? (windowElapsed - windowBusyTime) : 0;
+  utilization = (windowBusyTime >= windowElapsed) ? 100 : uint8_t ((windowBusyTime * 100) / windowElapsed);
+  windowLoopCount = loopCounter;
+  loopCounter = 0;
+  windowStart = microsValue;
 
-      // If the current interval in the sequence list is not elapsed.
-      if (elapsedTime < sequenceList [sequenceIndex]) {
-        return false;
+  if (utilization > peakUtilization) {
+    peakUtilization = utilization;
+  }
+
+  if (utilization >= overloadThreshold) {
+    overloaded = true;
+    overloadCounter++;
+    shed();
+  }
+  else if (utilization <= recoveryThreshold) {
+    overloaded = false;
+    recover();
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Takes one step of load shedding. With PT_SHED_STRETCH, the intervals of
+ * all low priority tasks are doubled, up to maxStretch times the original.
+ * Only ONESHOT and SPANNING tasks have intervals that can be stretched, so
+ * RATELIMIT, TRIGGERED and CALENDAR tasks are left alone by this policy.
+ * With PT_SHED_SUSPEND, one more low priority task is suspended.
+ * 
+ */
+void ptMonitor:: shed() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    ptScheduler* task = taskList [i];
+
+    ptTaskProfile* profile = task->profile;
+
+    if ((profile == nullptr) || (!profile->lowPriority)) { // Low priority tasks always have a profile
+      continue;
+    }
+
+    if (shedMode == PT_SHED_STRETCH) {
+      if ((task->schedule->taskMode != PT_MODE_ONESHOT) && (task->schedule->taskMode != PT_MODE_SPANNING)) {
+        continue;
       }
 
-      // If the current interval in the sequence is elapsed.
-      if (sequenceIndex < (sequenceLength - 1)) { // Check if we have reached the end of the list.
-        sequenceIndex++; // If not, move to the next interval.
+      if ((profile->intervalScale * 2) <= maxStretch) {
+        profile->intervalScale *= 2;
+        profile->taskShed = true;
       }
-      else { // If all intervals in the sequence have been elapsed.
-        sequenceIndex = 0;
-        // sequenceRepetition counter should only increment when the task in not in suspended state.
-        if (!taskSuspended) {
-          sequenceRepetitionCounter++;
-        }
+    }
+    else if (shedMode == PT_SHED_SUSPEND) {
+      // Tasks suspended by the user are left alone.
+      if ((!profile->taskShed) && task->taskEnabled && (!task->taskSuspended)) {
+        task->suspend();
+        profile->taskShed = true;
+        return;
       }
+    }
+  }
+}
 
-      cycleStarted = false; // Reset so that we can start a new interval cycle.
-      exitTime = entryTime + elapsedTime; // Save the exit time.
-      lastElapsedTime = elapsedTime;
-      return false;
+//==============================================================================//
+/**
+ * @brief Undoes one step of load shedding. Stretched intervals are halved and
+ * one suspended task is resumed.
+ * 
+ */
+void ptMonitor:: recover() {
+  for (uint8_t i = 0; i < taskCount; i++) {
+    ptScheduler* task = taskList [i];
+    ptTaskProfile* profile = task->profile;
+
+    if ((profile == nullptr) || (!profile->taskShed)) {
+      continue;
+    }
+
+    if (profile->intervalScale > 1) {
+      profile->intervalScale /= 2;
+      profile->taskShed = (profile->intervalScale > 1);
+    }
+    else {
+      task->resume();
+      profile->taskShed = false;
+      return;
     }
   }
+}
 
-  else {
-    return false; //if not activated
+//==============================================================================//
+/**
+ * @brief Sets the load shedding policy.
+ * 
+ * @param mode PT_SHED_NONE, PT_SHED_STRETCH or PT_SHED_SUSPEND.
+ * @param overload Utilization in percent at which shedding starts.
+ * @param recovery Utilization in percent at which shedding is undone. Must be lower than overload.
+ * @return true If the values are valid.
+ * @return false If the values are invalid.
+ */
+bool ptMonitor:: setShedMode (uint8_t mode, uint8_t overload, uint8_t recovery) {
+  switch (mode) {
+    case PT_SHED_NONE:
+    case PT_SHED_STRETCH:
+    case PT_SHED_SUSPEND:
+      break;
+
+    default:
+      return false;
   }
 
-  return false;
+  if ((overload > 100) || (recovery >= overload)) {
+    return false;
+  }
+
+  shedMode = mode;
+  overloadThreshold = overload;
+  recoveryThreshold = recovery;
+  return true;
 }
 
 //==============================================================================//
 /**
- * @brief Prints the state variables and counters of the task.
- * Unfortunately, print() does not accept 64-bit values.
- * So values like timespans will be truncated to 32-bit.
+ * @brief Returns the overload state. The task set is overloaded if the
+ * utilization of the last window reached the overload threshold.
  * 
+ * @return true If overloaded.
+ * @return false If not overloaded.
  */
-void ptScheduler:: printStats() {
-  debugSerial.print (F("Interval Sequence Length: "));
-  debugSerial.println (sequenceLength);
-  debugSerial.print (F("Intervals (us): "));
+bool ptMonitor:: isOverloaded() {
+  return overloaded;
+}
+
+//==============================================================================//
+//==============================================================================//
+// Constructors
 
-  for (int i = 0; i < sequenceLength; i++) {
-    debugSerial.print ((int32_t) sequenceList [i]);
+/**
+ * @brief Creates a coalescer for a list of tasks. The coalescer finds how long
+ * the loop can sleep, so that tasks whose deadlines are close together run in a
+ * single wakeup. How close is decided by the slack time of each task (see
+ * ptScheduler::setSlackTime()).
+ * 
+ * @param tasks Pointer to an array of task pointers.
+ * @param count Number of tasks in the array.
+ * @return ptCoalescer:: 
+ */
+ptCoalescer:: ptCoalescer (ptScheduler** tasks, uint8_t count) {
+  taskList = tasks;
+  taskCount = (tasks != nullptr) ? count : 0;
 
-    if (i != (sequenceLength - 1)) {
-      debugSerial.print (F(", "));
+  if (taskCount > 0) {
+    taskDeadlines = new time_us_t [taskCount];  // Deadlines found in the last call of getSleepTime()
+  }
+
+  // Measure how late the tasks run, so that the cost of coalescing can be seen. ONESHOT tasks
+  // are also kept in phase, so that the deadlines found stay where they were.
+  for (uint8_t i = 0; i < taskCount; i++) {
+    taskList [i]->getProfile()->coalesced = true;
+  }
+}
+
+//==============================================================================//
+/**
+ * @brief Returns how long the loop can sleep before the next wakeup. Call this
+ * after calling all the tasks, and then sleep for the returned time in any way
+ * you like. The wakeup is normally placed at the earliest deadline. It is only
+ * delayed if that lets it serve other deadlines as well; then it is placed at
+ * the latest deadline that can be reached before any task runs out of its
+ * slack time. So no task runs more than its slack time late, and a wakeup
+ * that serves a single deadline is never delayed.
+ * 
+ * The number of wakeups saved is counted by comparing with waking up at every
+ * distinct deadline.
+ * 
+ * @return time_us_t Sleep time in microseconds. 0 if a task has to be called now.
+ * PT_TIME_NEVER if none of the tasks has a deadline.
+ */
+time_us_t ptCoalescer:: getSleepTime() {
+  time_us_t latest = PT_TIME_NEVER;  // The latest wakeup that keeps every task within its slack time
+  time_us_t earliest = PT_TIME_NEVER;  // The earliest deadline
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    time_us_t deadline = taskList [i]->getTimeToNextRun();
+    taskDeadlines [i] = deadline;
+
+    if (deadline == PT_TIME_NEVER) {
+      continue;
     }
-    else {
-      debugSerial.println();
+
+    if (deadline < earliest) {
+      earliest = deadline;
     }
-  }
-    
-  debugSerial.print (F ("Task Mode: "));
-  debugSerial.println (taskMode);
-  debugSerial.print (F ("Sleep Mode: "));
-  debugSerial.println (sleepMode);
-  debugSerial.print (F ("Skip Interval: "));
-  debugSerial.println (skipInterval);
-  debugSerial.print (F ("Skip Sequence: "));
-  debugSerial.println (skipSequence);
-  debugSerial.print (F ("Skip Time: "));
-  debugSerial.println ((int32_t) skipTime);
-  debugSerial.print (F ("sequenceRepetition: "));
-  debugSerial.println (sequenceRepetition);
-  debugSerial.print (F ("Entry Time: "));
-  debugSerial.println ((int32_t) entryTime);
-  debugSerial.print (F ("Elapsed Time: "));
-  debugSerial.println ((int32_t) elapsedTime);
-  debugSerial.print (F ("Last Elapsed Time: "));
-  debugSerial.println ((int32_t) lastElapsedTime);
-  debugSerial.print (F ("Exit Time: "));
-  debugSerial.println ((int32_t) exitTime);
-  debugSerial.print (F ("Interval Counter: "));
-  debugSerial.println ((uint32_t) intervalCounter);
-  debugSerial.print (F ("Sleep Interval Counter: "));
-  debugSerial.println ((uint32_t) suspendedIntervalCounter);
-  debugSerial.print (F ("Execution Counter: "));
-  debugSerial.println ((uint32_t) executionCounter);
-  debugSerial.print (F ("sequenceRepetition Counter: "));
-  debugSerial.println ((uint32_t) sequenceRepetitionCounter);
-  debugSerial.print (F ("Task Enabled?: "));
-  debugSerial.println (taskEnabled);
-  debugSerial.print (F ("Task Suspended?: "));
-  debugSerial.println (taskSuspended);
-  debugSerial.print (F ("Task Started?: "));
-  debugSerial.println (taskStarted);
-  debugSerial.print (F ("Cycle Started?: "));
-  debugSerial.println (cycleStarted);
-  debugSerial.print (F ("Task Running?: "));
-  debugSerial.println (taskRunning);
-  debugSerial.print (F ("Task Ended?: "));
-  debugSerial.println (sequenceRepetitionEnded);
-  debugSerial.print (F ("Task Run State: "));
-  debugSerial.println (taskRunState);
-  debugSerial.print (F ("Input Error: "));
-  debugSerial.println (inputError);
-  debugSerial.println();
+
+    time_us_t slack = (taskList [i]->profile != nullptr) ? taskList [i]->profile->slackTime : 0;
+
+    if ((deadline + slack) < latest) {
+      latest = deadline + slack;
+    }
+  }
+
+  sleepTime = earliest;
+
+  if ((earliest == 0) || (earliest == PT_TIME_NEVER)) {
+    return earliest;
+  }
+
+  // Move the wakeup to the latest deadline that can share it. If no other deadline is
+  // close enough, this is the earliest deadline itself.
+  time_us_t wakeup = earliest;
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if ((taskDeadlines [i] <= latest) && (taskDeadlines [i] > wakeup)) {
+      wakeup = taskDeadlines [i];
+    }
+  }
+
+  sleepTime = wakeup;
+
+  // Count the distinct deadlines served by this wakeup.
+  uint8_t deadlines = 0;
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    if (taskDeadlines [i] > wakeup) {
+      continue;
+    }
+
+    bool isDistinct = true;
+
+    for (uint8_t j = 0; j < i; j++) {
+      if (taskDeadlines [j] == taskDeadlines [i]) {
+        isDistinct = false;
+        break;
+      }
+    }
+
+    if (isDistinct) {
+      deadlines++;
+    }
+  }
+
+  wakeupCount++;
+  deadlineCount += deadlines;
+  return wakeup;
 }
 
 //==============================================================================//
 /**
- * @brief Activates or enables a task. Only active tasks are executed
- * regardless of their turn for execution.
+ * @brief Returns the number of wakeups saved by coalescing, compared to waking
+ * up at every distinct deadline.
  * 
+ * @return uint32_t Number of wakeups saved.
  */
-void ptScheduler:: enable() {
-  taskEnabled = true;
+uint32_t ptCoalescer:: getWakeupsSaved() {
+  return deadlineCount - wakeupCount;
 }
 
 //==============================================================================//
 /**
- * @brief Returns the task enable state.
+ * @brief Returns the greatest common divisor of two values.
  * 
- * @return true Task is enabled.
- * @return false Task is disabled.
+ * @param a First value.
+ * @param b Second value.
+ * @return time_us_t The greatest common divisor. a if b is 0.
  */
-bool ptScheduler:: isEnabled() {
-  return taskEnabled;
+static time_us_t getGcd (time_us_t a, time_us_t b) {
+  while (b != 0) {
+    time_us_t remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+  return a;
 }
 
 //==============================================================================//
+// Constructors
+
 /**
- * @brief Suspends a task. The task will not be executed until it is resumed.
- * suspendedIntervalCounter will continue to increment in this mode, which you can
- * monitor to determine how long the task has been suspended and resume the task
- * if necessary.
+ * @brief Creates a cyclic executive for a list of tasks and builds its frame
+ * table. See build() for the requirements. If the table can not be built, the
+ * cyclic executive falls back to calling the tasks one by one.
  * 
+ * @param tasks Pointer to an array of task pointers. Up to PT_CYCLIC_MAX_TASKS tasks.
+ * @param count Number of tasks in the array.
+ * @return ptCyclic:: 
  */
-void ptScheduler:: suspend() {
-  taskSuspended = true;
-
-  // If the execution counter is reset to 0 when suspending a task,
-  // the task will start a fresh interval cycle when resumed.
-  if (toClearExecutionCounter) {
-    executionCounter = 0;
-  }
+ptCyclic:: ptCyclic (ptScheduler** tasks, uint8_t count) {
+  taskList = tasks;
+  taskCount = (tasks != nullptr) ? count : 0;
+  build();
 }
 
 //==============================================================================//
 /**
- * @brief Returns the suspended state of the task.
+ * @brief Frees the frame table, if it was built by build(), and detaches the
+ * tasks. The tasks must not be destroyed before the cyclic executive.
  * 
- * @return true Task is suspended.
- * @return false Task is not suspended.
+ * @return ptCyclic:: 
  */
-bool ptScheduler:: isSuspended() {
-  return taskSuspended;
+ptCyclic:: ~ptCyclic() {
+  detachTasks();
+  releaseTable();
 }
 
 //==============================================================================//
 /**
- * @brief Resumes a task from suspended state. The task will resume from where it
- * was suspended.
+ * @brief Makes the tasks report to this cyclic executive when they are enabled,
+ * disabled, suspended or resumed, and finds the enabled mask from their current
+ * states. A task can only be attached to one cyclic executive at a time; the
+ * last one wins. Bits without a task stay set.
  * 
  */
-void ptScheduler:: resume() {
-  taskSuspended = false;
-  // intervalCounter = 0;
+void ptCyclic:: attachTasks() {
+  enabledMask = ~uint32_t (0);
+
+  for (uint8_t i = 0; (i < taskCount) && (i < PT_CYCLIC_MAX_TASKS); i++) {
+    ptTaskProfile* profile = taskList [i]->getProfile();
+    profile->cyclic = this;
+    profile->cyclicIndex = i;
+
+    if ((!taskList [i]->taskEnabled) || taskList [i]->taskSuspended) {
+      enabledMask &= ~(uint32_t (1) << i);
+    }
+  }
 }
 
 //==============================================================================//
 /**
- * @brief Disables a task. This will reset all values to their default states.
- * All user specified values will be preserved, which includes the mode, skip
- * interval, time, sequenceRepetition, default interval, etc. You have to call
- * either enable() or reset() functions to enable the task.
+ * @brief Stops the tasks from reporting to this cyclic executive.
  * 
  */
-void ptScheduler:: disable() {
-  taskEnabled = false;
-  taskStarted = false;
-  cycleStarted = false;
-  taskSuspended = false;
-  sequenceRepetitionEnded = true;
-  taskRunning = false;
-  taskRunState = false;
+void ptCyclic:: detachTasks() {
+  for (uint8_t i = 0; (i < taskCount) && (i < PT_CYCLIC_MAX_TASKS); i++) {
+    ptTaskProfile* profile = taskList [i]->profile;
 
-  entryTime = 0;
-  exitTime = 0;
-  elapsedTime = 0;
-  timeDelta = 0;
-  prevTimeDelta = 0;
-  intervalCounter = 0;
-  suspendedIntervalCounter = 0;
-  executionCounter = 0;
-  sequenceRepetitionCounter = 0;
-  sequenceIndex = 0;
+    if ((profile != nullptr) && (profile->cyclic == this)) {
+      profile->cyclic = nullptr;
+    }
+  }
 }
 
 //==============================================================================//
 /**
- * @brief A reset reinitializes the task.
+ * @brief Frees the frame table if it was built by build(). Tables set with
+ * setTable() belong to the caller and are left alone.
  * 
  */
-void ptScheduler:: reset() {
-  disable();
-  enable();
+void ptCyclic:: releaseTable() {
+  if (tableOwned) {
+    delete [] frameTable;
+    tableOwned = false;
+  }
+
+  frameTable = nullptr;
 }
 
 //==============================================================================//
 /**
- * @brief Let's you specify the number of times the interval sequence has to be
- * executed. After the specified number of repetitions, the task will end and sleep
- * either through DISABLE or SUSPEND mode.
+ * @brief Builds a static frame table from the task definitions. The table
+ * replaces the timing checks of the individual tasks; in every base tick, a
+ * single table lookup tells which tasks are due. The base tick is the greatest
+ * common divisor of the periods (and start offsets), and the table covers one
+ * hyperperiod, which is the longest period for harmonic task sets.
  * 
- * @param value The number of sequences to execute.
- * @return true If the task in a valid mode and the repetition is set.
- * @return false If operation failed.
+ * All tasks must be enabled ONESHOT tasks with a single interval, without
+ * finite repetitions or stretched intervals. The skip time is used as the start
+ * offset of a task and must be shorter than its interval. The periods must be
+ * harmonic; every period must divide all longer periods. If any of this is not
+ * true, or the table would have more than PT_CYCLIC_MAX_FRAMES frames, the
+ * table is not built and fallback and inputError are set. The tasks are then
+ * called one by one in tick(), like in a normal loop. A table built earlier is
+ * freed first. The tasks are attached again, so tasks replaced in the task
+ * array since the last build are followed as well.
+ * 
+ * @return true If the table was built.
+ * @return false If the task set was rejected.
  */
-bool ptScheduler:: setSequenceRepetition (int32_t value) {
-  switch (taskMode) {
-    case PT_MODE_ONESHOT:
-      sequenceRepetition = value;
-      sequenceRepetitionExtended = value;
-      return true;
-      break;
-    
-    case PT_MODE_SPANNING:
-      // Determining how many sequenceRepetition have executed for a spanning task with odd no. of intervals is not
-      // straight forward as oneshot tasks. Odd number of intervals produce inverted output after every
-      // interval set. For example, if the intervals are 1000, 2000 and 3000, the first 1000 ms will be HIGH,
-      // next LOW for 2000 ms, then again high for 3000 ms. After that, the pattern is inverted. Since 3000 ms
-      // was HIGH, next 1000 ms will be LOW and so on. So counting just the HIGH states (execution counter) won't work.
-      // We need to calculate how many intervals we have to check to determine if the specified repetition has
-      // completed. But the user has to specify the number of sequenceRepetition only. Therefore we also calculate
-      // an additional parameter called sequenceRepetitionExtended which is the number of individual intervals to check.
-      sequenceRepetition = value;
-      
-      // If the sequenceRepetition is 1, then the sequenceRepetitionExtended is the same as the sequence length.
-      if (sequenceRepetition == 1) {
-        sequenceRepetitionExtended = sequenceLength;
-      }
-      else if ((sequenceRepetition % 2) == 1) { // If the sequenceRepetition is odd.
-        sequenceRepetitionExtended = uint32_t (((sequenceLength + 1) / 2) * sequenceRepetition);
-        sequenceRepetitionExtended--; // We need one less, otherwise there will be one extra active state.
-      }
-      else {
-        sequenceRepetitionExtended = uint32_t ((sequenceLength * sequenceRepetition) / 2);
-      }
-      return true;
-      break;
-    
-    default:
-      sequenceRepetition = 0;
-      sequenceRepetitionExtended = 0;
+bool ptCyclic:: build() {
+  releaseTable();
+  attachTasks();
+  frameCount = 0;
+  baseTick = 0;
+  hyperPeriod = 0;
+  fallback = true;
+  cyclicStarted = false;
+
+  if ((taskCount == 0) || (taskCount > PT_CYCLIC_MAX_TASKS)) {
+    inputError = true;
+    return false;
+  }
+
+  for (uint8_t i = 0; i < taskCount; i++) {
+    const ptScheduler* task = taskList [i];
+    const ptSchedule* schedule = task->schedule;
+
+    // Only plain periodic tasks can be placed in a table.
+    if ((!task->taskEnabled) || (schedule->taskMode != PT_MODE_ONESHOT) || (schedule->sequenceLength != 1) ||
+        (schedule->sequenceList [0] == 0) || (schedule->sequenceRepetition > 0) || (task->getIntervalScale() != 1) ||
+        (schedule->getScheduleStart() >= schedule->sequenceList [0])) {
       inputError = true;
       return false;
-      break;
+    }
+
+    time_us_t period = schedule->sequenceList [0];
+
+    // Every pair of periods must be harmonic.
+    for (uint8_t j = 0; j < i; j++) {
+      time_us_t otherPeriod = taskList [j]->schedule->sequenceList [0];
+
+      if (((period > otherPeriod) ? (period % otherPeriod) : (otherPeriod % period)) != 0) {
+        inputError = true;
+        return false;
+      }
+    }
+
+    baseTick = getGcd (getGcd (baseTick, period), schedule->getScheduleStart());
+
+    if (period > hyperPeriod) {
+      hyperPeriod = period;
+    }
   }
-  return false;
+
+  if ((hyperPeriod / baseTick) > PT_CYCLIC_MAX_FRAMES) {
+    inputError = true;
+    return false;
+  }
+
+  frameCount = hyperPeriod / baseTick;
+  uint32_t* table = new uint32_t [frameCount];
+
+  for (uint32_t frame = 0; frame < frameCount; frame++) {
+    time_us_t frameTime = frame * baseTick;
+    table [frame] = 0;
+
+    for (uint8_t i = 0; i < taskCount; i++) {
+      const ptSchedule* schedule = taskList [i]->schedule;
+
+      if ((frameTime % schedule->sequenceList [0]) == schedule->getScheduleStart()) {
+        table [frame] |= (uint32_t (1) << i);
+      }
+    }
+  }
+
+  frameTable = table;
+  tableOwned = true;
+  fallback = false;
+  return true;
 }
 
 //==============================================================================//
 /**
- * @brief Set the first interval value of an interval sequence.
+ * @brief Uses a frame table generated earlier, for example one printed with
+ * printTable() and compiled into the program. The tasks are not checked, and
+ * are not called at all. The table is not copied, and is not freed by the cyclic
+ * executive. A table built earlier by build() is freed.
  * 
- * @param value Time in microseconds.
- * @return true If the value is set.
- * @return false If the interval sequence is empty.
+ * @param table Pointer to the frame table. Bit n of a frame is set if task n is due.
+ * @param frames Number of frames in the table.
+ * @param tick Base tick in microseconds.
+ * @return true If the table was set.
+ * @return false If the values are invalid.
  */
-bool ptScheduler:: setInterval (time_us_t value) {
-  if (sequenceLength > 0) {
-    sequenceList [0] = value;
-    return true;
-  }
-  else {
+bool ptCyclic:: setTable (const uint32_t* table, uint32_t frames, time_us_t tick) {
+  if ((table == nullptr) || (frames == 0) || (tick == 0)) {
     inputError = true;
     return false;
   }
+
+  releaseTable();
+  frameTable = table;
+  frameCount = frames;
+  baseTick = tick;
+  hyperPeriod = tick * frames;
+  fallback = false;
+  cyclicStarted = false;
+  return true;
 }
 
 //==============================================================================//
 /**
- * @brief Let's you set the skip duration in terms of number of intervals to skip.
- * The number of intervals to skip can also be greater than the number of intervals
- * in the sequence. In that case, the skip duration will be calculated by summing up
- * the intervals in the sequence and saving to the skipTime variable.
+ * @brief Advances the cyclic executive. Call this once in every loop, and if it
+ * returns true, check the tasks with isDue(). A new frame starts every base tick,
+ * counted from the first call. Frames start at exact multiples of the base tick,
+ * so the jitter does not add up. If the loop falls behind by more than one
+ * frame, the frames are still run one by one in the following calls, and the
+ * overrun is counted.
  * 
- * If you set both skip interval and skip iteration, the last call determines the
- * skip duration.
+ * Tasks that are disabled or suspended (also by a ptMonitor) are not due, even
+ * if the table says so, as long as the task array was given. The tasks update
+ * the enabled mask themselves in enable(), disable(), suspend() and resume(), so
+ * this costs a single AND per frame; writing taskEnabled or taskSuspended
+ * directly is not followed. Other changes to the tasks after the table was
+ * built, like new intervals or intervals stretched by a ptMonitor, are not
+ * followed either; call build() again for those.
  * 
- * @param value The number of intervals to skip.
- * @return true If the operation is successful.
- * @return false If the sequence is empty.
+ * The due tasks are not called, so none of the bookkeeping of call() happens:
+ * dependent tasks are not triggered, no trace events are recorded and the
+ * execution and interval counters do not advance. Use the fallback mode (or
+ * call the tasks yourself) if you need those.
+ * 
+ * In fallback mode, the tasks are called one by one, and the due tasks are the
+ * ones that returned true.
+ * 
+ * @return true If a frame has started and any task is due.
+ * @return false If no task is due.
  */
-bool ptScheduler:: setSkipInterval (uint32_t value) {
-  if (sequenceLength > 0) {
-    skipInterval = value;
-
-    if (value == 0) {
-      skipIntervalSet = false;
-      skipTime = 0;
-      return true;
-    }
-
-    skipIntervalSet = true;
-    skipTime = 0;
-    uint32_t index = 0;
+bool ptCyclic:: tick() {
+  dueMask = 0;
 
-    for (uint32_t i = 0; i < value; i++) {
-      if (index == sequenceLength) {
-        index = 0;
+  if (fallback) {
+    for (uint8_t i = 0; (i < taskCount) && (i < PT_CYCLIC_MAX_TASKS); i++) {
+      if (taskList [i]->call()) {
+        dueMask |= (uint32_t (1) << i);
       }
-      skipTime += sequenceList [index]; // Summing up the intervals.
-      index++;
     }
-    return true;
+    return dueMask != 0;
   }
-  return false;
-}
 
-//==============================================================================//
-/**
- * @brief Let's you specify the skip duration in terms of number of sequences
- * to skip. The actual skip duration will be calculated as a multiple of the
- * interval sequence. Also remember that an interval sequence is a set of intervals.
- * 
- * @param value The number of sequences to skip.
- * @return true If the operation is successful.
- * @return false If the sequence is empty.
- */
-bool ptScheduler:: setSkipSequence (uint32_t value) {
-  if (sequenceLength > 0) {
-    skipSequence = value;
+  microsValue = GET_MICROS();
 
-    if (value == 0) {
-      skipSequenceSet = false;
-      skipTime = 0;
-      return true;
+  if (!cyclicStarted) {
+    cyclicStarted = true;
+    frameStart = microsValue;
+    frameIndex = 0;
+  }
+  else {
+    uint32_t elapsed = microsValue - frameStart;
+
+    if (elapsed < baseTick) {
+      return false;
     }
-    
-    skipSequenceSet = true;
-    skipTime = 0;
 
-    for (uint8_t i = 0; i < value; i++) {
-      for (uint8_t j = 0; j < sequenceLength; j++) {
-        skipTime += sequenceList [j];
-      }
+    if (elapsed >= (2 * baseTick)) {
+      overrunCount++;
     }
-    return true;
+
+    frameStart += uint32_t (baseTick);
+    frameIndex = (frameIndex < (frameCount - 1)) ? (frameIndex + 1) : 0;
   }
-  return false;
+
+  dueMask = frameTable [frameIndex] & enabledMask; // The table can not know about disabled or suspended tasks
+  return dueMask != 0;
 }
 
 //==============================================================================//
 /**
- * @brief Sets the skip duration in terms of time in microseconds.
+ * @brief Returns whether a task is due in the frame started by the last tick().
  * 
- * @param value Time in microseconds.
- * @return true If the operation is successful.
- * @return false If the sequence is empty.
+ * @param index Index of the task in the task array.
+ * @return true If the task is due.
+ * @return false If the task is not due.
  */
-bool ptScheduler:: setSkipTime (time_us_t value) {
-  if (sequenceLength > 0) {
-    skipTime = value;
-    
-    if (value == 0) {
-      skipTimeSet = false;
-    }
-
-    skipTimeSet = true;
-    return true;
+bool ptCyclic:: isDue (uint8_t index) {
+  if (index >= PT_CYCLIC_MAX_TASKS) {
+    return false;
   }
-  return false;
+  return (dueMask & (uint32_t (1) << index)) != 0;
 }
 
 //==============================================================================//
 /**
- * @brief Checks if there was any input error. Calling this function will
- * also reset the flag.
+ * @brief Prints the frame table as C code, so that it can be compiled into a
+ * program and used with setTable() without building it at startup.
  * 
- * @return true If there was an input error.
- * @return false If there was no input error.
+ * @param output The output stream, like Serial or a file.
  */
-bool ptScheduler:: isInputError() {
-  if (inputError) {
-    inputError = false;
-    return true;
+void ptCyclic:: printTable (Print& output) {
+  char value [12];
+
+  output.print (F ("// Base tick: "));
+  output.print ((uint32_t) baseTick);
+  output.print (F (" us, hyperperiod: "));
+  output.print ((uint32_t) hyperPeriod);
+  output.print (F (" us, tasks: "));
+  output.println (taskCount);
+  output.print (F ("const uint32_t frameTable ["));
+  output.print (frameCount);
+  output.println (F ("] = {"));
+
+  for (uint32_t i = 0; i < frameCount; i++) {
+    snprintf (value, sizeof (value), "0x%08lX", (unsigned long) frameTable [i]);
+
+    if ((i % 8) == 0) {
+      output.print (F ("  "));
+    }
+
+    output.print (value);
+
+    if (i != (frameCount - 1)) {
+      output.print (((i % 8) == 7) ? F (",\n") : F (", "));
+    }
   }
-  return false;
+
+  output.println (F ("\n};"));
 }
 
 //==============================================================================//
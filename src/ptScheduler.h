@@ -11,7 +11,7 @@
  * 
  * @version 2.2.0
  * @link https://github.com/vishnumaiea/ptScheduler
- * @date Last modified : +05:30 09:53:34 AM 27-06-2023, Tuesday
+ * @date Last modified : +05:30 08:31:05 PM 21-10-2026, Wednesday
  * @copyright License: MIT
  * 
  */
@@ -28,10 +28,17 @@
 
 #define  PT_MODE_ONESHOT    1
 #define  PT_MODE_SPANNING   2
+#define  PT_MODE_RATELIMIT  3
+#define  PT_MODE_TRIGGERED  4
+#define  PT_MODE_CALENDAR   5
 
 #define  PT_SLEEP_DISABLE   1    //self-disable mode
 #define  PT_SLEEP_SUSPEND   2    //self-suspend mode
 
+#define  PT_EDGE_NONE       0    //the output did not change
+#define  PT_EDGE_RISING     1    //the output changed to true
+#define  PT_EDGE_FALLING    2    //the output changed to false
+
 #define  PT_MS_MULTIPLIER   1000   //multiplier to convert ms to us
 
 // Time periods
@@ -69,63 +76,358 @@
 #define  PT_FREQ_1KHZ       PT_TIME_1MS
 
 #define  PT_TIME_DEFAULT    PT_TIME_1S
+#define  PT_TIME_NEVER      0xFFFFFFFFFFFFFFFFULL  // Returned when there is no deadline
+
+// Wall clock times in seconds, for the offsets of CALENDAR tasks. Multiply them
+// by PT_TIME_1S to use them as the period (interval) of a CALENDAR task.
+#define  PT_EPOCH_1MIN      60ULL
+#define  PT_EPOCH_5MIN      300ULL
+#define  PT_EPOCH_10MIN     600ULL
+#define  PT_EPOCH_15MIN     900ULL
+#define  PT_EPOCH_30MIN     1800ULL
+#define  PT_EPOCH_1HOUR     3600ULL
+#define  PT_EPOCH_1DAY      86400ULL
+#define  PT_EPOCH_1WEEK     604800ULL
+
+// Days of the week, for CALENDAR tasks
+#define  PT_DAY_SUNDAY      0x01
+#define  PT_DAY_MONDAY      0x02
+#define  PT_DAY_TUESDAY     0x04
+#define  PT_DAY_WEDNESDAY   0x08
+#define  PT_DAY_THURSDAY    0x10
+#define  PT_DAY_FRIDAY      0x20
+#define  PT_DAY_SATURDAY    0x40
+#define  PT_DAY_WEEKDAYS    0x3E
+#define  PT_DAY_WEEKEND     0x41
+#define  PT_DAY_ALL         0x7F
+
+// Schedule image
+#define  PT_IMAGE_MAGIC     0x46535450UL  // "PTSF" when stored in little-endian byte order
+#define  PT_IMAGE_VERSION   3
+
+#define  PT_IMAGE_SKIP_INTERVAL   0x01  // skipIntervalSet flag in a schedule record
+#define  PT_IMAGE_SKIP_SEQUENCE   0x02  // skipSequenceSet flag in a schedule record
+#define  PT_IMAGE_SKIP_TIME       0x04  // skipTimeSet flag in a schedule record
+
+// Load shedding policies
+#define  PT_SHED_NONE             0  // Only measure the utilization
+#define  PT_SHED_STRETCH          1  // Stretch the intervals of low priority tasks
+#define  PT_SHED_SUSPEND          2  // Suspend low priority tasks
+
+// Trace events
+#define  PT_TRACE_FIRE            1  // The task returned true
+#define  PT_TRACE_RISE            2  // The output of the task changed to true
+#define  PT_TRACE_FALL            3  // The output of the task changed to false
+#define  PT_TRACE_SUSPEND         4  // The task was suspended
+#define  PT_TRACE_RESUME          5  // The task was resumed
+#define  PT_TRACE_DISABLE         6  // The task was disabled
+#define  PT_TRACE_ENABLE          7  // The task was enabled
+#define  PT_TRACE_COMPLETE        8  // The task finished its work; carries the run duration
+
+// Number of events in a trace buffer. Must be a power of 2.
+#ifndef  PT_TRACE_SIZE
+  #define  PT_TRACE_SIZE          64
+#endif
+
+// Cyclic executive
+#define  PT_CYCLIC_MAX_TASKS      32  // One bit per task in a frame
+
+// Maximum number of frames in a cyclic executive table
+#ifndef  PT_CYCLIC_MAX_FRAMES
+  #define  PT_CYCLIC_MAX_FRAMES   1024
+#endif
+
+// State snapshots
+#define  PT_SNAPSHOT_MAGIC        0x5053  // "SP" when stored in little-endian byte order
+#define  PT_SNAPSHOT_VERSION      2
+
+#define  PT_SNAPSHOT_ENABLED      0x01  // taskEnabled
+#define  PT_SNAPSHOT_STARTED      0x02  // taskStarted
+#define  PT_SNAPSHOT_CYCLE        0x04  // cycleStarted
+#define  PT_SNAPSHOT_SUSPENDED    0x08  // taskSuspended
+#define  PT_SNAPSHOT_ENDED        0x10  // sequenceRepetitionEnded
+#define  PT_SNAPSHOT_RUNNING      0x20  // taskRunning
+#define  PT_SNAPSHOT_RUN_STATE    0x40  // taskRunState
+#define  PT_SNAPSHOT_SKIPPING     0x80  // The task was waiting for the skip time to elapse
 
 typedef uint64_t time_ms_t;  // Time in milliseconds
 typedef uint64_t time_us_t;  // Time in microseconds
+typedef uint64_t time_s_t;  // Wall clock time in seconds since the Unix epoch
+
+typedef time_s_t (*ptClockSource)();  // Returns the wall clock time for CALENDAR tasks
+
+class ptScheduler;
+class ptCyclic;
+typedef void (*ptEdgeCallback) (ptScheduler& task);  // Called when the output of a task changes
 
 // Add your own timing functions here
 #define  GET_MICROS         micros
 #define  GET_MILLIS         millis
 
 //==============================================================================//
-//main class
+// The runtime state of a task, saved by ptScheduler::snapshot(). You can keep it
+// in RTC RAM, EEPROM or a file and restore it after a reset or deep sleep.
+// The schedule definition itself (intervals, modes, skip values) is not part of
+// the snapshot; the task must be created with the same definition before restoring.
+
+struct ptSnapshot {
+  uint16_t magic; // Must be PT_SNAPSHOT_MAGIC
+  uint8_t version;  // Must be PT_SNAPSHOT_VERSION
+  uint8_t flags;  // PT_SNAPSHOT_* state flags
+  uint8_t taskMode; // Used to check if the task definition is the same
+  uint8_t sequenceLength; // Used to check if the task definition is the same
+  uint8_t sequenceIndex;  // Index position of interval sequence
+  uint8_t checksum; // Sum of all other bytes in the snapshot
+  time_us_t elapsedTime;  // Time elapsed in the ongoing interval or skip duration
+  uint64_t intervalCounter;
+  uint64_t suspendedIntervalCounter;
+  uint64_t executionCounter;
+  uint64_t sequenceRepetitionCounter;
+  time_us_t permitCredit; // Saved permits of a RATELIMIT task
+  uint64_t permitsGranted;
+  uint64_t permitsDenied;
+};
+
+//==============================================================================//
+// A single event recorded in a trace buffer
+
+struct ptTraceEvent {
+  uint32_t time;  // Value of micros() at the event
+  uint32_t duration;  // Run duration in microseconds, for PT_TRACE_COMPLETE events
+  uint16_t taskId;  // ID of the task, set with ptScheduler::setTrace()
+  uint8_t type; // PT_TRACE_* event type
+  uint8_t reserved;
+};
+
+//==============================================================================//
+// A fixed-size ring buffer of trace events. Tasks write to it from call() and
+// the other control functions, and you can read it out later without disturbing
+// the timing. The buffer has a single writer and a single reader, and does not
+// need locks. When full, the oldest events are overwritten.
+
+static_assert ((PT_TRACE_SIZE > 0) && (PT_TRACE_SIZE <= 32768) && ((PT_TRACE_SIZE & (PT_TRACE_SIZE - 1)) == 0),
+               "PT_TRACE_SIZE must be a power of 2, up to 32768");
+
+class ptTrace {
+  public :
+    ptTraceEvent events [PT_TRACE_SIZE];  // The ring buffer
+    volatile uint16_t head = 0; // Number of events written; wraps around. Changed only by the writer, with release ordering
+    uint16_t tail = 0;  // Number of events read; wraps around
+    uint32_t droppedCount = 0;  // Events overwritten before they were read
+    uint32_t prevTime = 0;  // Time of the last exported event, for extending the timestamps
+    uint64_t exportTime = 0;  // 64-bit timestamp of the last exported event
 
-class ptScheduler {
+    void record (uint16_t taskId, uint8_t type, uint32_t time, uint32_t duration = 0);
+    bool read (ptTraceEvent& event);
+    uint16_t available();
+    void clear();
+    void printChromeTrace (Print& output);
+};
+
+//==============================================================================//
+// All the data of a schedule. It is kept apart from the functions, so that a
+// schedule can be copied as a whole and then take its own copies of what it
+// owns (see ptSchedule (const ptSchedule&)).
+
+struct ptScheduleData {
+  time_us_t* sequenceList = nullptr;  // A pointer to the interval sequence
+  time_us_t* sequenceSums = nullptr;  // Prefix sums of the interval sequence; sequenceSums [i] is the sum of intervals 0 to i
+  time_us_t sequencePeriod = 0; // Sum of all intervals in the sequence
+  time_us_t skipTime = 0; // Time to wait before running a task
+  uint32_t sequenceRepetition = 0;  // How many times an interval sequence has to be executed
+  uint32_t sequenceRepetitionExtended = 0;  // Repetitions * interval sequence length
+  uint32_t skipInterval = 0;  // Number of individual intervals to skip
+  uint32_t skipSequence = 0; // Number of sequences (set of intervals) to skip
+  uint8_t sequenceLength = 0;  // How many intervals in a sequence
+  uint8_t sequenceSumsLength = 0; // Length of sequenceSums, if it was allocated by the schedule
+  uint8_t taskMode = PT_MODE_ONESHOT;  // The execution mode of the task
+  uint8_t sleepMode = PT_SLEEP_DISABLE; // Default is disable
+  bool skipIntervalSet = false; // If skip interval was set
+  bool skipSequenceSet = false;  // If skip sequence was set
+  bool skipTimeSet = false; // If skip time was set
+  bool inputError = false;  // If any user input parameters are wrong
+  time_s_t calendarOffset = 0;  // Offset of the fire times of a CALENDAR schedule from the Unix epoch, in seconds
+  uint8_t calendarDays = PT_DAY_ALL;  // Days of the week a CALENDAR schedule runs on
+  bool sequenceListOwned = false; // The sequence list was allocated by the schedule
+};
+
+//==============================================================================//
+// The definition of a schedule; the interval sequence, modes, repetitions and
+// skip duration. A schedule has no runtime state, so any number of tasks can
+// share the same schedule, each keeping only its own runtime state. Configure
+// a shared schedule before creating the tasks that use it. Tasks that change
+// their schedule (with setInterval(), setTaskMode() etc.) get their own copy.
+
+class ptSchedule : public ptScheduleData {
   private :
-    
+    void releaseSequence();
+    void abandonSequence();
+
   public :
-    time_us_t entryTime = 0;  // The entry time of a task, returned by micros()
-    time_us_t exitTime = 0; // The exit time of a task, returned by micros()
-    time_us_t elapsedTime = 0;  // Elapsed time since entry time
-    time_us_t lastElapsedTime = 0;
-    uint64_t intervalCounter = 0; // How many intervals have been passed
-    uint64_t suspendedIntervalCounter = 0; // How many intervals have been passed after suspending the task
-    uint64_t executionCounter = 0; // How many times the task has returned true
-    uint64_t sequenceRepetitionCounter = 0; // How many times the sequence has been repeated
-
-    uint32_t sequenceRepetition = 0;  // How many times an interval sequence has to be executed
-    uint32_t sequenceRepetitionExtended = 0;  // Repetitions * interval sequence length
-    uint8_t taskMode = PT_MODE_ONESHOT;  // The execution mode of the task
-    uint8_t sleepMode = PT_SLEEP_DISABLE; // Default is disable
-    uint8_t sequenceLength;  // How many intervals in a sequence
-    time_us_t* sequenceList;  // A pointer to the interval sequence
-    uint8_t sequenceIndex = 0;  // Index position of interval sequence
-    uint32_t skipInterval = 0;  // Number of individual intervals to skip
-    uint32_t skipSequence = 0; // Number of sequences (set of intervals) to skip
-    time_us_t skipTime = 0; // Time to wait before running a task
-    uint32_t prevTimeDelta = 0; // Previous time difference
-    uint32_t timeDelta = 0; // Current time difference
-    uint32_t microsValue = 0; // Value returned by micros()
+    // Description of all functions can be found in the .cpp file
+    ptSchedule() = default; // An empty schedule without intervals
+    ptSchedule (uint8_t mode, time_us_t interval_1);
+    ptSchedule (uint8_t mode, time_us_t* listPtr, uint8_t listLength);
+    ptSchedule (const ptSchedule& source);
+    ptSchedule (ptSchedule&& source);
+    ~ptSchedule();
+    ptSchedule& operator= (const ptSchedule& source);
+    ptSchedule& operator= (ptSchedule&& source);
+    bool setInterval (time_us_t value);
+    bool setTaskMode (uint8_t mode);
+    bool setSleepMode (uint8_t mode);
+    bool setSequenceRepetition (int32_t value);
+    bool setSkipInterval (uint32_t value);
+    bool setSkipSequence (uint32_t value);
+    bool setSkipTime (time_us_t value);
+    bool setCalendar (time_s_t offset, uint8_t days = PT_DAY_ALL);
+    time_s_t getCalendarPeriod() const;
+    time_s_t getNextFire (time_s_t time) const;
+    void updateSequence();
+    time_us_t getIntervalStart (uint64_t interval) const;
+    uint64_t getIntervalAt (time_us_t time) const;
+    uint64_t getEndInterval() const;
+    time_us_t getScheduleStart() const;
+    uint64_t getExecutionsAt (time_us_t time) const;
+    bool stateAt (time_us_t time) const;
+};
 
-    bool taskEnabled = true;  // Task is allowed to run or not
-    bool taskStarted = false; // Task has started an execution cycle
-    bool cycleStarted = false; // Task has started an interval cycle
-    bool taskSuspended = false; // A task is prevented from running until further activation
-    bool sequenceRepetitionEnded = false;  // End of a repetition
-    bool taskRunning = false; // The task is running
-    bool taskRunState;  // The current execution state of a task
+//==============================================================================//
+// The runtime state of the task modes that need more than the common state.
+// A task only uses the state of its own mode, so they share the same memory
+// in ptScheduler. These have no default values; ptScheduler::prepareModeState()
+// sets them up when the mode of the task changes.
+
+// Runtime state of a RATELIMIT task
+struct ptRateLimitState {
+  uint32_t permitsPerInterval;  // Permits added in every interval
+  uint32_t burstCapacity; // Maximum number of permits that can be saved up
+  time_us_t permitCredit; // Saved permits, scaled by the interval (one permit = one interval)
+  uint64_t permitsGranted;  // How many times a permit has been granted
+  uint64_t permitsDenied; // How many times a permit has been denied
+};
 
-    bool inputError = false;  // If any user input parameters are wrong
-    bool skipIntervalSet = false; // If skip interval was set
-    bool skipSequenceSet = false;  // If skip sequence was set
-    bool skipTimeSet = false; // If skip time was set
-    bool toClearExecutionCounter = false; // If the execution counter has to be cleared
+// Runtime state of a TRIGGERED task
+struct ptTriggerState {
+  uint8_t triggerCount; // How many times the task has been triggered; only changed atomically by trigger()
+  uint8_t triggerCountSeen; // How many triggers have been consumed
+  uint8_t triggersRequired; // Number of triggers needed to run the task once
+  uint8_t triggerCountLast; // Trigger counter value seen in the last call
+  uint32_t eventTime; // Value of micros() when the last new trigger was seen
+  time_us_t holdoffTime;  // Minimum time between two runs
+  time_us_t debounceTime; // Time the triggers have to settle before the task runs
+  bool timedOut;  // If the last run was caused by the interval instead of a trigger
+  uint32_t runTime; // Value of micros() when the task last ran; the interval and hold-off time are counted from here
+};
+
+// Runtime state of a CALENDAR task
+struct ptCalendarState {
+  ptClockSource clockSource;  // Returns the wall clock time
+  time_s_t clockTime; // Wall clock time seen in the last call
+  time_s_t nextFireTime;  // Wall clock time at which the task runs next
+  time_s_t lastFireTime;  // Wall clock time at which the task last ran
+};
 
+//==============================================================================//
+// The parts of a task that only some tasks need; the measurements for tracing,
+// monitoring and coalescing, the interval stretching of ptMonitor, the dependent
+// tasks and the edge callbacks. They are kept out of ptScheduler, and allocated
+// by the functions that need them (see ptScheduler::getProfile()).
+
+struct ptTaskProfile {
+  ptTrace* trace = nullptr; // Trace buffer to record events to
+  uint16_t taskId = 0;  // ID of the task in the trace
+  uint32_t lastRunTime = 0; // Run duration saved by complete(), in microseconds
+  time_us_t busyTime = 0; // Sum of the run durations, collected and cleared by ptMonitor
+  time_us_t slackTime = 0;  // How late the task is allowed to run, so that it can share a wakeup with other tasks
+  time_us_t latenessTime = 0; // Sum of the time the ends of intervals were found late
+  time_us_t maxLateness = 0;  // Largest time an end of interval was found late
+  uint32_t latenessCount = 0; // Number of ends of intervals measured
+  bool coalesced = false; // The task was added to a ptCoalescer
+  ptCyclic* cyclic = nullptr; // The cyclic executive that follows the enabled state of the task
+  uint8_t cyclicIndex = 0;  // Index of the task in that cyclic executive
+  uint8_t intervalScale = 1;  // All intervals are multiplied by this; used for stretching the intervals
+  bool lowPriority = false; // Low priority tasks can be slowed down or suspended by ptMonitor
+  bool taskShed = false;  // The task was slowed down or suspended by ptMonitor
+  uint8_t dependentCount = 0; // Number of tasks in the dependent list
+  ptScheduler** dependentList = nullptr;  // Tasks to trigger every time this task executes
+  ptEdgeCallback risingCallback = nullptr;  // Called when the output changes to true
+  ptEdgeCallback fallingCallback = nullptr; // Called when the output changes to false
+  time_us_t exitTime = 0; // The time the last interval ended, counted like entryTime; 0 if none yet
+  time_us_t lastElapsedTime = 0;  // Elapsed time of the last ended interval
+};
+
+//==============================================================================//
+// All the data of a task. It is kept apart from the functions, so that a task
+// can be copied as a whole and then take its own copies of what it owns (see
+// ptScheduler (const ptScheduler&)).
+
+struct ptTaskState {
+  time_us_t entryTime = 0;  // The entry time of a task, returned by micros()
+  time_us_t elapsedTime = 0;  // Elapsed time since entry time
+  uint64_t intervalCounter = 0; // How many intervals have been passed
+  uint64_t suspendedIntervalCounter = 0; // How many intervals have been passed after suspending the task
+  uint64_t executionCounter = 0; // How many times the task has returned true
+  uint64_t sequenceRepetitionCounter = 0; // How many times the sequence has been repeated
+
+  ptSchedule* schedule; // The schedule definition; can be shared with other tasks
+  bool scheduleShared = false;  // The schedule is not owned by the task and must be copied before changing
+  bool scheduleInterned = false;  // The schedule is a single interval schedule shared by reference count
+  uint8_t sequenceIndex = 0;  // Index position of interval sequence
+  uint8_t stateMode = 0;  // The task mode the mode state was prepared for; 0 if none
+  uint32_t prevTimeDelta = 0; // Previous time difference
+  uint32_t timeDelta = 0; // Current time difference
+  uint32_t microsValue = 0; // Value returned by micros()
+  uint32_t runStartTime = 0;  // Value of micros() when the task last returned true
+
+  bool taskEnabled = true;  // Task is allowed to run or not
+  bool taskStarted = false; // Task has started an execution cycle
+  bool cycleStarted = false; // Task has started an interval cycle
+  bool taskSuspended = false; // A task is prevented from running until further activation
+  bool sequenceRepetitionEnded = false;  // End of a repetition
+  bool taskRunning = false; // The task is running
+  bool taskRunState;  // The current execution state of a task
+
+  bool inputError = false;  // If any user input parameters are wrong
+  bool toClearExecutionCounter = false; // If the execution counter has to be cleared
+  bool lastCallState = false; // The value returned by the last call()
+
+  union { // Runtime state of the task mode; only the state of the mode in stateMode is valid
+    ptRateLimitState rateLimitState;
+    ptTriggerState triggerState;
+    ptCalendarState calendarState;
+  };
+
+  ptTaskProfile* profile = nullptr; // Measurements, stretching, dependents and callbacks; allocated when needed
+};
+
+//==============================================================================//
+//main class
+
+class ptScheduler : public ptTaskState {
+  private :
+    void releaseState();
+    void abandonState();
+    void refillPermits (time_us_t elapsed);
+    void updateCyclic();
+    void releaseSchedule();
+    
+  public :
     // Description of all functions can be found in the .cpp file
+    ptScheduler();
     ptScheduler (time_us_t interval_1);
     ptScheduler (uint8_t _mode, time_us_t interval_1);
     ptScheduler (uint8_t _mode, time_us_t* listPtr, uint8_t listLength);
+    ptScheduler (const ptSchedule& sharedSchedule);
+    ptScheduler (const ptScheduler& task);
+    ptScheduler (ptScheduler&& task);
     ~ptScheduler();
+    ptScheduler& operator= (const ptScheduler& task);
+    ptScheduler& operator= (ptScheduler&& task);
+    void setSchedule (const ptSchedule& sharedSchedule);
+    bool detachSchedule();
+    void prepareModeState (uint8_t mode);
+    ptTaskProfile* getProfile();
     void reset();
     void enable();
     bool isEnabled();
@@ -135,17 +437,193 @@ class ptScheduler {
     void resume();
     bool oneshot();
     bool spanning();
+    bool ratelimit();
+    bool triggered();
+    bool calendar();
+    void trigger();
+    bool addDependent (ptScheduler& task);
+    bool hasDependent (const ptScheduler& task) const;
+    bool setTriggerCount (uint8_t count);
+    void setHoldoffTime (time_us_t value);
+    void setDebounceTime (time_us_t value);
+    bool setCalendar (time_s_t offset, uint8_t days = PT_DAY_ALL);
+    void setClockSource (ptClockSource source);
+    uint64_t getElapsedIntervals();
+    bool resync (uint64_t intervals);
     bool call();
+    uint8_t edge();
+    void setEdgeCallbacks (ptEdgeCallback rising, ptEdgeCallback falling);
     bool setInterval (time_us_t value);
     bool setSequenceRepetition (int32_t value);
     bool setSkipInterval (uint32_t value);
     bool setSkipSequence (uint32_t value);
     bool setSkipTime (time_us_t value);
+    bool stateAt (time_us_t time) const;
+    static void stateAt (const ptScheduler* tasks, uint32_t taskCount, const time_us_t* times, uint32_t timeCount, bool* states);
+    void rebaseTime (time_us_t elapsed);
+    bool seek (time_us_t time);
+    bool seekInterval (uint64_t interval);
+    bool setRateLimit (uint32_t permits, uint32_t burst);
     bool setTaskMode (uint8_t mode);
     bool setSleepMode (uint8_t mode);
     bool isInputError();
     void printStats();
     void getTimeElapsed();
+    void setLowPriority (bool value);
+    bool setIntervalScale (uint8_t value);
+    uint8_t getIntervalScale() const;
+    time_us_t getTimeToNextRun();
+    void setSlackTime (time_us_t value);
+    void recordLateness (time_us_t lateness);
+    void setTrace (ptTrace* buffer, uint16_t id);
+    void complete();
+    void snapshot (ptSnapshot& state);
+    bool restore (const ptSnapshot& state, time_us_t timeOffset = 0);
+};
+
+//==============================================================================//
+// Schedule images
+
+// The header of a binary schedule image. An image is laid out as the header,
+// followed by the task records, followed by the interval table and the table of
+// prefix sums of each interval sequence (see sequenceSums). All values are
+// stored in the native byte order and every section is 8-byte aligned, so that
+// an image can be memory-mapped (or placed in flash) and used in place.
+struct ptImageHeader {
+  uint32_t magic; // Must be PT_IMAGE_MAGIC
+  uint16_t version; // Must be PT_IMAGE_VERSION
+  uint16_t recordSize;  // Size of a single task record in bytes
+  uint32_t taskCount; // Number of task records
+  uint32_t intervalCount; // Number of intervals in the interval table
+};
+
+// Definition of a single task inside a schedule image
+struct ptImageRecord {
+  time_us_t skipTime; // Skip duration as calculated by the skip functions
+  uint32_t intervalOffset;  // Index of the first interval of the sequence in the interval table
+  uint32_t sequenceRepetition;  // How many times the interval sequence has to be executed
+  uint32_t skipInterval;  // Number of individual intervals to skip
+  uint32_t skipSequence;  // Number of sequences to skip
+  uint8_t sequenceLength; // How many intervals in the sequence
+  uint8_t taskMode; // The execution mode of the task
+  uint8_t sleepMode;  // The sleep mode of the task
+  uint8_t skipFlags;  // PT_IMAGE_SKIP_* flags
+  uint32_t calendarOffset;  // Offset of the fire times of a CALENDAR task, in seconds
+  uint8_t calendarDays; // Days of the week a CALENDAR task runs on
+  uint8_t reserved [7]; // Keeps the record size a multiple of 8 bytes
+};
+
+class ptScheduleImage {
+  public :
+    const ptImageHeader* header = nullptr;  // Points to the start of the image
+    const ptImageRecord* records = nullptr; // Points to the first task record
+    const time_us_t* intervals = nullptr; // Points to the interval table
+    const time_us_t* sums = nullptr;  // Points to the prefix sum table
+
+    bool begin (const void* image, size_t imageSize);
+    uint32_t getTaskCount();
+    bool load (ptSchedule& schedule, uint32_t index);
+    bool apply (ptScheduler& task, ptSchedule& schedule, uint32_t index);
+    uint32_t applyAll (ptScheduler* tasks, ptSchedule* schedules, uint32_t taskCount);
+    static size_t getImageSize (uint32_t taskCount, uint32_t intervalCount);
+    static size_t write (ptScheduler* tasks, uint32_t taskCount, void* buffer, size_t bufferSize);
+};
+
+//==============================================================================//
+// Measures the CPU utilization of a set of tasks, and optionally sheds load by
+// slowing down or suspending the low priority tasks when overloaded.
+
+class ptMonitor {
+  public :
+    ptScheduler** taskList; // Pointer to the array of task pointers
+    uint8_t taskCount;  // Number of tasks in the array
+    time_us_t windowTime; // Measurement window in microseconds
+    uint32_t windowStart = 0; // Value of micros() at the start of the window
+    uint32_t microsValue = 0; // Value returned by micros()
+    time_us_t busyTime = 0; // Time spent in the tasks during the last window
+    time_us_t idleTime = 0; // Time not spent in the tasks during the last window
+    uint32_t loopCounter = 0; // Loops counted in the ongoing window
+    uint32_t windowLoopCount = 0; // Loops counted in the last window
+    uint32_t overloadCounter = 0; // Number of windows that were overloaded
+    uint8_t utilization = 0;  // Busy time of the last window, in percent
+    uint8_t peakUtilization = 0;  // Highest utilization seen
+    uint8_t overloadThreshold = 90; // Utilization in percent at which shedding starts
+    uint8_t recoveryThreshold = 70; // Utilization in percent at which shedding is undone
+    uint8_t shedMode = PT_SHED_NONE;  // Load shedding policy
+    uint8_t maxStretch = 8; // Maximum interval multiplier for PT_SHED_STRETCH
+    bool overloaded = false;  // The last window was overloaded
+    bool monitorStarted = false;  // The first window has started
+
+    ptMonitor (ptScheduler** tasks, uint8_t count, time_us_t window = PT_TIME_1S);
+    void update();
+    void shed();
+    void recover();
+    bool setShedMode (uint8_t mode, uint8_t overload = 90, uint8_t recovery = 70);
+    bool isOverloaded();
+};
+
+//==============================================================================//
+// Finds how long the loop can sleep, so that tasks whose deadlines are within
+// their slack times of each other run in a single wakeup.
+
+class ptCoalescer {
+  public :
+    ptScheduler** taskList; // Pointer to the array of task pointers
+    uint8_t taskCount;  // Number of tasks in the array
+    time_us_t* taskDeadlines = nullptr; // Time to the next run of each task, found in the last call
+    time_us_t sleepTime = 0;  // Sleep time returned by the last call
+    uint32_t wakeupCount = 0; // Number of wakeups planned
+    uint32_t deadlineCount = 0; // Number of distinct deadlines served by those wakeups
+
+    ptCoalescer (ptScheduler** tasks, uint8_t count);
+    ptCoalescer (const ptCoalescer&) = delete;  // The deadline list is owned by a single coalescer
+    ~ptCoalescer() { delete [] taskDeadlines; }
+    ptCoalescer& operator= (const ptCoalescer&) = delete;
+    time_us_t getSleepTime();
+    uint32_t getWakeupsSaved();
+};
+
+//==============================================================================//
+// A cyclic executive for harmonic sets of periodic tasks. A table of the due
+// tasks in every frame of the hyperperiod is built once, and then each base tick
+// takes a single table lookup instead of checking every task. In table mode the
+// tasks are not called, so their dependents are not triggered, no trace events
+// are recorded and their counters do not advance; only the fallback mode calls
+// the tasks.
+
+class ptCyclic {
+  private :
+    void releaseTable();
+    void attachTasks();
+    void detachTasks();
+
+  public :
+    ptScheduler** taskList; // Pointer to the array of task pointers
+    uint8_t taskCount;  // Number of tasks in the array
+    const uint32_t* frameTable = nullptr; // Due tasks of each frame; bit n is set if task n is due
+    bool tableOwned = false;  // The frame table was allocated by build() and is freed with it
+    uint32_t frameCount = 0;  // Number of frames in the table
+    time_us_t baseTick = 0; // Length of a frame in microseconds
+    time_us_t hyperPeriod = 0;  // Length of the table in microseconds
+    uint32_t frameIndex = 0;  // The ongoing frame
+    uint32_t frameStart = 0;  // Value of micros() at the start of the ongoing frame
+    uint32_t microsValue = 0; // Value returned by micros()
+    uint32_t dueMask = 0; // Tasks due in the frame started by the last tick()
+    uint32_t enabledMask = ~uint32_t (0); // Tasks that are enabled and not suspended; kept up to date by the tasks
+    uint32_t overrunCount = 0;  // Number of frames started more than a base tick late
+    bool cyclicStarted = false; // The first frame has started
+    bool fallback = true; // The table could not be built; the tasks are called one by one
+    bool inputError = false;  // If the task set was rejected
+
+    ptCyclic (ptScheduler** tasks, uint8_t count);
+    ptCyclic (const ptCyclic&) = delete;  // The frame table is owned by a single cyclic executive
+    ~ptCyclic();
+    ptCyclic& operator= (const ptCyclic&) = delete;
+    bool build();
+    bool setTable (const uint32_t* table, uint32_t frames, time_us_t tick);
+    bool tick();
+    bool isDue (uint8_t index);
+    void printTable (Print& output);
 };
 
 //==============================================================================//